@@ -0,0 +1,35 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+
+namespace tser_bench
+{
+	/// @brief Keeps the optimizer from discarding a computed value
+	inline void do_not_optimize(const auto& value)
+	{
+		static const void* volatile sink;
+		sink = &value;
+	}
+
+	/// @brief Runs a callable repeatedly and prints the average time per iteration
+	void measure(std::string_view name, std::size_t iterations, auto&& fn)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < iterations; ++i) {
+			fn();
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		std::cout << "\t\t" << name << ": " << ns / static_cast<long long>(iterations) << " ns/op\n";
+	}
+
+	// benchmarks
+	void bench_analytics();
+	void bench_role_parser();
+	void bench_stress();
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "analytics.h"
+#include "bench.h"
+#include "memory_repository.h"
+
+using namespace tser;
+
+namespace
+{
+	constexpr std::size_t role_count = 100'000;
+	constexpr std::size_t group_count = 1'000;
+	constexpr std::size_t parent_count = 10'000;
+	constexpr std::size_t leaf_count = 20'000;
+	constexpr std::size_t leaves_per_parent = 32;
+	constexpr std::size_t parents_per_group = 4;
+
+	/// groups include parents, parents include leaves, the remaining roles are unused
+	void fill(MemoryRepository& repo)
+	{
+		std::vector<Role> roles;
+		roles.reserve(role_count);
+		for (std::size_t i = 0; i < role_count; ++i) {
+			roles.emplace_back("role", std::to_string(i));
+		}
+		repo.add_roles(std::move(roles));
+
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<std::size_t> parent(group_count, group_count + parent_count - 1);
+		std::uniform_int_distribution<std::size_t> leaf(group_count + parent_count, group_count + parent_count + leaf_count - 1);
+
+		// parents must be included before they get subroles of their own
+		std::vector<std::pair<Role::Uuid, Role::Uuid>> edges;
+		for (std::size_t g = 0; g < group_count; ++g) {
+			for (std::size_t i = 0; i < parents_per_group; ++i) {
+				edges.emplace_back(std::to_string(g), std::to_string(parent(rng)));
+			}
+		}
+
+		for (std::size_t p = group_count; p < group_count + parent_count; ++p) {
+			for (std::size_t i = 0; i < leaves_per_parent; ++i) {
+				edges.emplace_back(std::to_string(p), std::to_string(leaf(rng)));
+			}
+		}
+
+		repo.include_roles(edges);
+	}
+}
+
+void
+tser_bench::bench_analytics()
+{
+	MemoryRepository repo;
+	fill(repo);
+
+	const auto workers = std::max(1u, std::thread::hardware_concurrency());
+	std::cout << "\t" << role_count << " roles, " << workers << " workers\n";
+
+	measure("build", 3, [&] {
+		do_not_optimize(Analytics::build(repo, workers));
+	});
+
+	const auto analytics = Analytics::build(repo, workers).value();
+	const auto role = std::to_string(group_count);
+
+	measure("overlap", 20, [&] {
+		do_not_optimize(analytics.overlap(role, 10));
+	});
+
+	// the same question, answered from the full listing
+	measure("overlap, from roles()", 3, [&] {
+		const auto roles = repo.roles();
+		const auto& own = roles.at(role);
+
+		std::vector<std::pair<std::size_t, const Role*>> counts;
+		for (const auto& other : std::views::values(roles)) {
+			const auto count = std::ranges::count_if(other.subroles(), [&](const auto& sub) {
+				return own.has_subrole(sub);
+			});
+			counts.emplace_back(count, &other);
+		}
+
+		std::partial_sort(counts.begin(), counts.begin() + 10, counts.end(), std::greater{});
+		do_not_optimize(counts);
+	});
+
+	measure("impact", 20, [&] {
+		do_not_optimize(analytics.impact(100));
+	});
+
+	const auto leaf = std::to_string(group_count + parent_count);
+	const auto other_leaf = std::to_string(group_count + parent_count + 1);
+	measure("common parents", 20, [&] {
+		do_not_optimize(analytics.common_parents({ leaf, other_leaf }));
+	});
+
+	// as served: the server keeps one engine and rebuilds it once the repository changed
+	std::cout << "\tserved through AnalyticsCache\n";
+
+	const auto served = std::make_shared<MemoryRepository>();
+	fill(*served);
+
+	measure("overlap, first request", 1, [&] {
+		auto cache = AnalyticsCache(served, workers, std::chrono::milliseconds(0));
+		do_not_optimize(cache.get().value()->overlap(role, 10));
+	});
+
+	auto cache = AnalyticsCache(served, workers, std::chrono::milliseconds(0));
+	cache.get();
+
+	measure("overlap, unchanged repository", 20, [&] {
+		do_not_optimize(cache.get().value()->overlap(role, 10));
+	});
+
+	// each request follows a write, the worst case for a cache without staleness
+	std::size_t writes = 0;
+	measure("overlap, after a write", 3, [&] {
+		served->add_role(Role("role", "write " + std::to_string(writes++)));
+		do_not_optimize(cache.get().value()->overlap(role, 10));
+	});
+}
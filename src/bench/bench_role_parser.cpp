@@ -0,0 +1,41 @@
+#include <string>
+
+#include "bench.h"
+#include "role.h"
+
+using namespace tser;
+
+namespace
+{
+	/// builds the body of an add request with the given number of included roles
+	std::string make_body(std::size_t subroles)
+	{
+		auto role = Role("a fairly long role name, as used by operators", "4f0f8a0e-6a8c-4f4b-9a2a-3b8d1d2f9c11");
+		for (std::size_t i = 0; i < subroles; ++i) {
+			role.add_subrole("4f0f8a0e-6a8c-4f4b-9a2a-" + std::to_string(100000000000 + i));
+		}
+
+		return nlohmann::json(role).dump();
+	}
+}
+
+void
+tser_bench::bench_role_parser()
+{
+	for (const std::size_t subroles : { 0, 16, 256 }) {
+		const auto body = make_body(subroles);
+		const auto iterations = 1'000'000 / (subroles + 1) + 1'000;
+
+		std::cout << "\t" << subroles << " included roles, " << body.size() << " bytes\n";
+
+		measure("dom", iterations, [&] {
+			Role role = nlohmann::json::parse(body);
+			do_not_optimize(role);
+		});
+
+		measure("sax", iterations, [&] {
+			auto role = Role::parse(body);
+			do_not_optimize(role);
+		});
+	}
+}
@@ -0,0 +1,421 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "memory_repository.h"
+
+using namespace tser;
+
+/// Contention stress harness: many threads drive a repository with random add/include/exclude/dependencies calls.
+/// Short rounds over a few roles are recorded and checked for linearizability against a sequential model;
+/// long runs over many roles measure the throughput and the latency tail.
+
+namespace
+{
+	// linearizability rounds; the checker tracks the linearized operations in a 64 bit mask
+	constexpr std::size_t check_roles = 4;
+	constexpr std::size_t check_ops = 24;
+	constexpr std::size_t check_max_threads = 16;
+	constexpr std::size_t check_rounds = 2'000;
+
+	// throughput runs
+	constexpr std::size_t load_roles = 10'000;
+	constexpr std::size_t load_ops_per_thread = 100'000;
+
+	enum class Kind
+	{
+		ADD,
+		INCLUDE,
+		EXCLUDE,
+		DEPENDENCIES,
+	};
+
+	/// @brief One call and what it returned; roles are indices into the round's universe
+	struct Op
+	{
+		Kind kind;
+		std::size_t role;
+		std::size_t subrole;
+
+		RepositoryErr result = RepositoryErr::OK;
+		std::uint32_t parents = 0;
+
+		// ticks of the round's clock; a call precedes another if it responded before the other was invoked
+		std::uint64_t invoked = 0;
+		std::uint64_t responded = 0;
+	};
+
+	/// @brief Sequential specification of the repository over the roles of a check round
+	struct Model
+	{
+		std::uint32_t exists = 0;
+		std::array<std::uint32_t, check_roles> subroles {};
+
+		bool has(std::size_t role) const
+		{
+			return exists & (1u << role);
+		}
+
+		/// @brief Applies the call and fills in what the repository has to return for it
+		void apply(Op& op)
+		{
+			const auto role_bit = 1u << op.role;
+			const auto subrole_bit = 1u << op.subrole;
+			op.parents = 0;
+
+			switch (op.kind) {
+			case Kind::ADD:
+				op.result = has(op.role) ? RepositoryErr::ROLE_ALREADY_EXISTS : RepositoryErr::OK;
+				exists |= role_bit;
+				break;
+
+			case Kind::INCLUDE:
+				if (op.role == op.subrole) {
+					op.result = RepositoryErr::ILLEGAL_OP;
+				}
+				else if (!has(op.role) || !has(op.subrole)) {
+					op.result = RepositoryErr::ROLE_NOT_FOUND;
+				}
+				else if (subroles[op.subrole] != 0) {
+					op.result = RepositoryErr::ROLE_HAS_SUBROLE;
+				}
+				else if (subroles[op.role] & subrole_bit) {
+					op.result = RepositoryErr::UNKNOWN_ERR;
+				}
+				else {
+					op.result = RepositoryErr::OK;
+					subroles[op.role] |= subrole_bit;
+				}
+				break;
+
+			case Kind::EXCLUDE:
+				if (!has(op.role)) {
+					op.result = RepositoryErr::ROLE_NOT_FOUND;
+				}
+				else if (!(subroles[op.role] & subrole_bit)) {
+					op.result = RepositoryErr::UNKNOWN_ERR;
+				}
+				else {
+					op.result = RepositoryErr::OK;
+					subroles[op.role] &= ~subrole_bit;
+				}
+				break;
+
+			case Kind::DEPENDENCIES:
+				op.result = has(op.subrole) ? RepositoryErr::OK : RepositoryErr::ROLE_NOT_FOUND;
+				for (std::size_t parent = 0; parent < check_roles && op.result == RepositoryErr::OK; ++parent) {
+					if (subroles[parent] & subrole_bit) {
+						op.parents |= 1u << parent;
+					}
+				}
+				break;
+			}
+		}
+
+		std::uint64_t key() const
+		{
+			auto key = static_cast<std::uint64_t>(exists);
+			for (const auto subrole : subroles) {
+				key = (key << check_roles) | subrole;
+			}
+
+			return key;
+		}
+	};
+
+	static_assert(check_roles * (check_roles + 1) <= 64, "the model key has to fit into 64 bits");
+
+	Role::Uuid
+	uuid(std::size_t role)
+	{
+		return std::to_string(role);
+	}
+
+	Op
+	random_op(std::mt19937& rng, std::size_t roles)
+	{
+		std::uniform_int_distribution<std::size_t> role(0, roles - 1);
+		std::uniform_int_distribution<int> kind(0, 9);
+
+		// mostly edge churn, with a few reads and adds
+		static constexpr std::array<Kind, 10> kinds {
+			Kind::ADD,
+			Kind::INCLUDE, Kind::INCLUDE, Kind::INCLUDE, Kind::INCLUDE,
+			Kind::EXCLUDE, Kind::EXCLUDE, Kind::EXCLUDE,
+			Kind::DEPENDENCIES, Kind::DEPENDENCIES,
+		};
+
+		return Op { .kind = kinds[kind(rng)], .role = role(rng), .subrole = role(rng) };
+	}
+
+	/// @brief Runs the call and records its result; parents are only recorded for the check universe
+	void
+	execute(IRepository& repository, Op& op, const std::vector<Role::Uuid>& uuids)
+	{
+		switch (op.kind) {
+		case Kind::ADD:
+			op.result = repository.add_role(Role("role", uuids[op.role]));
+			break;
+
+		case Kind::INCLUDE:
+			op.result = repository.include_role(uuids[op.role], uuids[op.subrole]);
+			break;
+
+		case Kind::EXCLUDE:
+			op.result = repository.exclude_role(uuids[op.role], uuids[op.subrole]);
+			break;
+
+		case Kind::DEPENDENCIES: {
+			const auto parents = repository.dependencies(uuids[op.subrole]);
+			op.result = parents ? RepositoryErr::OK : parents.error();
+			if (parents && parents.value() && uuids.size() <= check_roles) {
+				for (std::size_t parent = 0; parent < uuids.size(); ++parent) {
+					if (parents.value()->contains(uuids[parent])) {
+						op.parents |= 1u << parent;
+					}
+				}
+			}
+			break;
+		}
+		}
+	}
+
+	/// @brief Searches for an order of the calls which respects their real-time order and the model (Wing & Gong, with memoization)
+	bool
+	linearizable(const std::vector<Op>& history, const Model& initial)
+	{
+		const auto all = history.size() == 64 ? ~std::uint64_t{} : (std::uint64_t{ 1 } << history.size()) - 1;
+
+		// states from which the remaining calls are known not to linearize
+		std::set<std::pair<std::uint64_t, std::uint64_t>> dead_ends;
+
+		const std::function<bool(std::uint64_t, const Model&)> search = [&](std::uint64_t done, const Model& model) {
+			if (done == all) {
+				return true;
+			}
+
+			if (!dead_ends.emplace(done, model.key()).second) {
+				return false;
+			}
+
+			// only calls invoked before every pending call responded can come next
+			auto first_response = ~std::uint64_t{};
+			for (std::size_t i = 0; i < history.size(); ++i) {
+				if (!(done & (std::uint64_t{ 1 } << i))) {
+					first_response = std::min(first_response, history[i].responded);
+				}
+			}
+
+			for (std::size_t i = 0; i < history.size(); ++i) {
+				if ((done & (std::uint64_t{ 1 } << i)) || history[i].invoked > first_response) {
+					continue;
+				}
+
+				auto next = model;
+				auto expected = history[i];
+				next.apply(expected);
+
+				if (expected.result == history[i].result && expected.parents == history[i].parents
+					&& search(done | (std::uint64_t{ 1 } << i), next)) {
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+		return search(0, initial);
+	}
+
+	const char*
+	kind_name(Kind kind)
+	{
+		switch (kind) {
+		case Kind::ADD:				return "add";
+		case Kind::INCLUDE:			return "include";
+		case Kind::EXCLUDE:			return "exclude";
+		case Kind::DEPENDENCIES:	return "dependencies";
+		}
+
+		return "?";
+	}
+
+	void
+	print_history(const std::vector<Op>& history)
+	{
+		for (const auto& op : history) {
+			std::cout << "\t\t\t[" << op.invoked << ", " << op.responded << "] "
+				<< kind_name(op.kind) << "(" << op.role << ", " << op.subrole << ") -> "
+				<< static_cast<int>(op.result) << ", parents " << op.parents << "\n";
+		}
+	}
+
+	/// @brief Runs concurrent rounds on fresh repositories and checks each history
+	/// @returns whether every round was linearizable
+	bool
+	check_rounds_linearizable(const std::function<std::unique_ptr<IRepository>()>& make_repository, std::size_t threads)
+	{
+		threads = std::min(threads, check_max_threads);
+		const auto ops_per_thread = std::max<std::size_t>(2, check_ops / threads);
+
+		std::vector<Role::Uuid> uuids;
+		for (std::size_t i = 0; i < check_roles; ++i) {
+			uuids.push_back(uuid(i));
+		}
+
+		for (std::size_t round = 0; round < check_rounds; ++round) {
+			// all but the last role exist up front, so that adds can both succeed and fail
+			const auto repository = make_repository();
+			Model initial;
+			for (std::size_t i = 0; i + 1 < check_roles; ++i) {
+				Op add { .kind = Kind::ADD, .role = i, .subrole = i };
+				execute(*repository, add, uuids);
+				initial.apply(add);
+			}
+
+			std::vector<std::vector<Op>> recorded(threads);
+			std::atomic<std::uint64_t> clock = 0;
+			std::barrier start(static_cast<std::ptrdiff_t>(threads));
+
+			{
+				std::vector<std::jthread> workers;
+				for (std::size_t t = 0; t < threads; ++t) {
+					workers.emplace_back([&, t] {
+						std::mt19937 rng(static_cast<std::uint32_t>(round * check_max_threads + t));
+						start.arrive_and_wait();
+
+						for (std::size_t i = 0; i < ops_per_thread; ++i) {
+							auto op = random_op(rng, check_roles);
+							op.invoked = clock.fetch_add(1);
+							execute(*repository, op, uuids);
+							op.responded = clock.fetch_add(1);
+							recorded[t].push_back(op);
+						}
+					});
+				}
+			}
+
+			std::vector<Op> history;
+			for (const auto& ops : recorded) {
+				history.insert(history.end(), ops.begin(), ops.end());
+			}
+
+			if (!linearizable(history, initial)) {
+				std::cout << "\t\tround " << round << " is not linearizable:\n";
+				print_history(history);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/// @brief Drives a prefilled repository from the given number of threads and prints ops/s and latency percentiles
+	void
+	measure_load(const std::function<std::unique_ptr<IRepository>()>& make_repository, std::size_t threads)
+	{
+		const auto repository = make_repository();
+
+		std::vector<Role> roles;
+		for (std::size_t i = 0; i < load_roles; ++i) {
+			roles.emplace_back("role", uuid(i));
+		}
+		repository->add_roles(std::move(roles));
+
+		// adds target fresh uuids, so that they do not all fail once the run is warm
+		std::vector<Role::Uuid> uuids;
+		for (std::size_t i = 0; i < 2 * load_roles; ++i) {
+			uuids.push_back(uuid(i));
+		}
+
+		std::vector<std::vector<std::uint64_t>> latencies(threads);
+		std::barrier start(static_cast<std::ptrdiff_t>(threads + 1));
+
+		std::chrono::steady_clock::time_point begin;
+		{
+			std::vector<std::jthread> workers;
+			for (std::size_t t = 0; t < threads; ++t) {
+				workers.emplace_back([&, t] {
+					std::mt19937 rng(static_cast<std::uint32_t>(t));
+					std::uniform_int_distribution<std::size_t> fresh(load_roles, 2 * load_roles - 1);
+					latencies[t].reserve(load_ops_per_thread);
+					start.arrive_and_wait();
+
+					for (std::size_t i = 0; i < load_ops_per_thread; ++i) {
+						auto op = random_op(rng, load_roles);
+						if (op.kind == Kind::ADD) {
+							op.role = fresh(rng);
+						}
+
+						const auto invoked = std::chrono::steady_clock::now();
+						execute(*repository, op, uuids);
+						const auto latency = std::chrono::steady_clock::now() - invoked;
+
+						latencies[t].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+					}
+				});
+			}
+
+			begin = std::chrono::steady_clock::now();
+			start.arrive_and_wait();
+		}
+		const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+		std::vector<std::uint64_t> all;
+		for (const auto& thread : latencies) {
+			all.insert(all.end(), thread.begin(), thread.end());
+		}
+		std::ranges::sort(all);
+
+		const auto percentile = [&](double p) {
+			return all[std::min(all.size() - 1, static_cast<std::size_t>(p * static_cast<double>(all.size())))];
+		};
+
+		std::cout << "\t\t" << static_cast<std::uint64_t>(static_cast<double>(all.size()) / elapsed) << " ops/s"
+			<< ", p50 " << percentile(0.5) << " ns"
+			<< ", p99 " << percentile(0.99) << " ns"
+			<< ", p99.9 " << percentile(0.999) << " ns"
+			<< ", max " << all.back() << " ns\n";
+	}
+}
+
+void
+tser_bench::bench_stress()
+{
+	const std::function<std::unique_ptr<IRepository>()> make_repository = [] {
+		return std::make_unique<MemoryRepository>();
+	};
+
+	const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+
+	// 2 and 4 threads always run, even on fewer cores: preemption still interleaves them, so the check covers races there too
+	std::set<std::size_t> thread_counts { 1, 2, 4, hardware };
+	for (std::size_t threads = 8; threads < hardware; threads *= 2) {
+		thread_counts.insert(threads);
+	}
+
+	for (const auto threads : thread_counts) {
+		std::cout << "\t" << threads << " threads\n";
+
+		if (threads > 1) {
+			if (!check_rounds_linearizable(make_repository, threads)) {
+				std::exit(EXIT_FAILURE);
+			}
+
+			std::cout << "\t\t" << check_rounds << " rounds linearizable\n";
+		}
+
+		measure_load(make_repository, threads);
+	}
+}
@@ -0,0 +1,40 @@
+#include <iostream>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+#include "bench.h"
+
+/// Micro-benchmarks for the hot paths of the server.
+/// Usage: bench.exe [name...] -- runs the given benchmarks, or all of them when none is given
+
+int main(int argc, const char* argv[])
+{
+	const std::unordered_map<std::string_view, void (*)()> benchmarks {
+		{"analytics", &tser_bench::bench_analytics},
+		{"role_parser", &tser_bench::bench_role_parser},
+		{"stress", &tser_bench::bench_stress},
+	};
+
+	const auto args = std::span(argv, argc).subspan(1);
+	if (args.empty()) {
+		for (const auto& [name, bench] : benchmarks) {
+			std::cout << name << "\n";
+			bench();
+		}
+
+		return 0;
+	}
+
+	for (const std::string_view name : args) {
+		if (!benchmarks.contains(name)) {
+			std::cout << "\nError: Unknown benchmark " << name << "\n\n";
+			return 1;
+		}
+
+		std::cout << name << "\n";
+		benchmarks.at(name)();
+	}
+
+	return 0;
+}
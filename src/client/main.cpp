@@ -1,9 +1,11 @@
 #include <concepts>
 #include <format>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <ranges>
 #include <span>
+#include <sstream>
 #include <unordered_map>
 
 #include <restclient-cpp/restclient.h>
@@ -28,6 +30,8 @@ void handle_roles(std::string_view uri, std::ranges::view auto);
 void handle_simulate(std::string_view uri, std::ranges::view auto args);
 void handle_include(std::string_view uri, std::ranges::view auto args);
 void handle_exclude(std::string_view uri, std::ranges::view auto args);
+void handle_import(std::string_view uri, std::ranges::view auto args);
+void handle_delete(std::string_view uri, std::ranges::view auto args);
 
 int main(int argc, const char* argv[])
 {
@@ -51,6 +55,8 @@ int main(int argc, const char* argv[])
 		{"simulate", &handle_simulate},
 		{"include", &handle_include},
 		{"exclude", &handle_exclude},
+		{"import", &handle_import},
+		{"delete", &handle_delete},
 	};
 
 	// handle help
@@ -119,6 +125,8 @@ void print_help()
 		<< "\t simulate <subrole_id> -- Returns a list of roles which include the given sub-role \n"
 		<< "\t include <role_id> <subrole_id> -- Includes a sub-role in a given role \n"
 		<< "\t exclude <role_id> <subrole_id> -- Excludes a sub-role from a given role \n"
+		<< "\t delete <role_id> [restrict] -- Deletes a role and its inclusions; with restrict, fails if other roles include it \n"
+		<< "\t import <file> -- Imports roles from a file with one role JSON per line \n"
 		;
 }
 
@@ -187,4 +195,37 @@ void handle_exclude(std::string_view uri, std::ranges::view auto args) {
 	const auto response = RestClient::post(full_path, "", "");
 
 	print_response(response);
-}
\ No newline at end of file
+}
+
+void handle_import(std::string_view uri, std::ranges::view auto args) {
+	if (args.size() != 1) {
+		std::cout << "\nError: Not enough parameters\n\n";
+		return;
+	}
+
+	std::ifstream file(std::string(args[0]), std::ios::binary);
+	if (!file) {
+		std::cout << "\nError: Cannot open " << args[0] << "\n\n";
+		return;
+	}
+
+	std::stringstream body;
+	body << file.rdbuf();
+
+	const auto full_path = std::format("{}/import", uri);
+	const auto response = RestClient::post(full_path, "application/x-ndjson", body.str());
+
+	print_response(response);
+}
+
+void handle_delete(std::string_view uri, std::ranges::view auto args) {
+	if (args.size() != 1 && !(args.size() == 2 && args[1] == "restrict")) {
+		std::cout << "\nError: Not enough parameters\n\n";
+		return;
+	}
+
+	const auto full_path = std::format("{}/roles/{}{}", uri, args[0], args.size() == 2 ? "?restrict=true" : "");
+	const auto response = RestClient::del(full_path);
+
+	print_response(response);
+}
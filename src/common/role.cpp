@@ -1,7 +1,163 @@
 #include "role.h"
 
+#include <vector>
+
 using namespace tser;
 
+namespace
+{
+	/// @brief SAX handler which collects the Role fields straight from the parser's buffers
+	/// Validation is deferred until the whole text was parsed, so that errors match the DOM path:
+	/// duplicate keys overwrite earlier ones and the fields are checked in the order of from_json
+	class RoleSax : public nlohmann::json_sax<nlohmann::json>
+	{
+	public:
+		struct Field
+		{
+			const char* type = nullptr;
+			std::string value;
+		};
+
+		struct ArrayField
+		{
+			const char* type = nullptr;
+			const char* bad_element = nullptr;
+			std::vector<std::string> values;
+		};
+
+		const char* root = nullptr;
+		Field name;
+		Field id;
+		ArrayField included;
+
+		bool null() override { return value("null"); }
+		bool boolean(bool) override { return value("boolean"); }
+		bool number_integer(number_integer_t) override { return value("number"); }
+		bool number_unsigned(number_unsigned_t) override { return value("number"); }
+		bool number_float(number_float_t, const string_t&) override { return value("number"); }
+		bool string(string_t& val) override { return value("string", &val); }
+		bool binary(binary_t&) override { return value("binary"); }
+
+		bool start_object(std::size_t) override
+		{
+			value("object");
+			++depth;
+			return true;
+		}
+
+		bool end_object() override
+		{
+			--depth;
+			return true;
+		}
+
+		bool start_array(std::size_t) override
+		{
+			value("array");
+			++depth;
+			return true;
+		}
+
+		bool end_array() override
+		{
+			--depth;
+			return true;
+		}
+
+		bool key(string_t& val) override
+		{
+			if (depth == 1) {
+				current = val == "name" ? Key::NAME
+					: val == "id" ? Key::ID
+					: val == "includedRoles" ? Key::INCLUDED
+					: Key::OTHER;
+			}
+
+			return true;
+		}
+
+		// sax_parse calls through the concrete handler type, so this overload receives the concrete exception
+		// and rethrows it unsliced, as the DOM parser does
+		template<class Exception>
+		bool parse_error(std::size_t, const std::string&, const Exception& ex)
+		{
+			throw ex;
+		}
+
+		bool parse_error(std::size_t position, const std::string& token, const nlohmann::detail::exception& ex) override
+		{
+			return parse_error<nlohmann::detail::exception>(position, token, ex);
+		}
+
+	private:
+		enum class Key
+		{
+			NONE,
+			NAME,
+			ID,
+			INCLUDED,
+			OTHER,
+		};
+
+		std::size_t depth = 0;
+		Key current = Key::NONE;
+
+		bool value(const char* type, string_t* str = nullptr)
+		{
+			if (depth == 0) {
+				root = type;
+			}
+			else if (depth == 1) {
+				switch (current) {
+				case Key::NAME:
+					set(name, type, str);
+					break;
+				case Key::ID:
+					set(id, type, str);
+					break;
+				case Key::INCLUDED:
+					included = ArrayField{ .type = type };
+					break;
+				default:
+					break;
+				}
+			}
+			else if (depth == 2 && current == Key::INCLUDED && included.type == std::string_view("array")) {
+				if (str) {
+					included.values.push_back(std::move(*str));
+				}
+				else if (!included.bad_element) {
+					included.bad_element = type;
+				}
+			}
+
+			return true;
+		}
+
+		static void set(Field& field, const char* type, string_t* str)
+		{
+			field.type = type;
+			if (str) {
+				field.value = std::move(*str);
+			}
+		}
+	};
+
+	void
+	expect_string(const char* key, const RoleSax::Field& field)
+	{
+		using nlohmann::json;
+
+		if (!field.type) {
+			throw json::out_of_range::create(403, std::string("key '") + key + "' not found", nullptr);
+		}
+
+		if (field.type != std::string_view("string")) {
+			throw json::type_error::create(302, std::string("type must be string, but is ") + field.type, nullptr);
+		}
+	}
+}
+
 Role::Role(Name name, Uuid uuid)
 	: name {std::move(name)}
 	, uuid {std::move(uuid)}
@@ -23,7 +179,7 @@ Role::has_subrole(Uuid subrole) const
 bool
 Role::add_subrole(Uuid subrole)
 {
-	auto [_, ok] = sub_roles.insert(subrole);
+	auto [_, ok] = sub_roles.insert(std::move(subrole));
 	return ok;
 }
 
@@ -33,6 +189,53 @@ Role::rem_subrole(Uuid subrole)
 	return 1 == sub_roles.erase(subrole);
 }
 
+const std::unordered_set<Role::Uuid>&
+Role::subroles() const
+{
+	return sub_roles;
+}
+
+Role
+Role::parse(std::string_view text)
+{
+	using nlohmann::json;
+
+	RoleSax sax;
+	json::sax_parse(text, &sax);
+
+	if (sax.root != std::string_view("object")) {
+		throw json::type_error::create(304, std::string("cannot use at() with ") + sax.root, nullptr);
+	}
+
+	expect_string("name", sax.name);
+	expect_string("id", sax.id);
+
+	Role role(std::move(sax.name.value), std::move(sax.id.value));
+
+	if (sax.included.type) {
+		if (sax.included.type != std::string_view("array")) {
+			throw json::type_error::create(302, std::string("type must be array, but is ") + sax.included.type, nullptr);
+		}
+
+		if (sax.included.bad_element) {
+			throw json::type_error::create(302, std::string("type must be string, but is ") + sax.included.bad_element, nullptr);
+		}
+
+		role.sub_roles.reserve(sax.included.values.size());
+		for (auto& subrole : sax.included.values) {
+			role.sub_roles.insert(std::move(subrole));
+		}
+	}
+
+	return role;
+}
+
+void
+Role::compact()
+{
+	sub_roles.rehash(0);
+}
+
 void
 tser::to_json(nlohmann::json& j, const Role& role)
 {
@@ -5,6 +5,7 @@
 
 // std
 #include <string>
+#include <string_view>
 #include <unordered_set>
 
 namespace tser
@@ -32,8 +33,17 @@ namespace tser
 
 		bool rem_subrole(Uuid subrole);
 
+		const std::unordered_set<Uuid>& subroles() const;
+
+		/// @brief Shrinks the storage of the subroles down to what their count needs
+		void compact();
+
 		auto operator<=>(const Role&) const = default;
 
+		/// @brief Parses a role straight from JSON text, without building an intermediate DOM
+		/// @throws nlohmann::json::exception - the same errors as nlohmann::json::parse(text).get<Role>()
+		static Role parse(std::string_view text);
+
 	private:
 		std::unordered_set<Uuid> sub_roles;
 
@@ -0,0 +1,175 @@
+#include "admission.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace tser;
+
+AdaptiveLimiter::AdaptiveLimiter(Config config)
+	: config { config }
+	, current_limit { static_cast<double>(std::clamp(config.initial_limit, config.min_limit, config.max_limit)) }
+{
+}
+
+bool
+AdaptiveLimiter::acquire()
+{
+	std::unique_lock lk{ mutex };
+	const auto has_slot = [this] {
+		return in_flight_count < static_cast<std::size_t>(current_limit);
+	};
+
+	if (!has_slot()) {
+		if (queued >= config.max_queued || in_flight_count + queued >= config.max_threads) {
+			return false;
+		}
+
+		++queued;
+		const auto ok = cv.wait_for(lk, config.max_wait, has_slot);
+		--queued;
+
+		if (!ok) {
+			return false;
+		}
+	}
+
+	++in_flight_count;
+	return true;
+}
+
+void
+AdaptiveLimiter::release(std::chrono::nanoseconds latency)
+{
+	{
+		std::scoped_lock lk{ mutex };
+		--in_flight_count;
+
+		// additive increase of ~1 per window of successful requests, multiplicative decrease on slow ones
+		if (latency <= config.target_latency) {
+			current_limit = std::min(static_cast<double>(config.max_limit), current_limit + 1.0 / current_limit);
+		}
+		else {
+			current_limit = std::max(static_cast<double>(config.min_limit), current_limit * config.backoff);
+		}
+	}
+
+	cv.notify_one();
+}
+
+std::size_t
+AdaptiveLimiter::limit() const
+{
+	std::scoped_lock lk{ mutex };
+	return static_cast<std::size_t>(current_limit);
+}
+
+std::size_t
+AdaptiveLimiter::in_flight() const
+{
+	std::scoped_lock lk{ mutex };
+	return in_flight_count;
+}
+
+AdmissionController::Permit::Permit(std::atomic<std::size_t>* route_in_flight, AdaptiveLimiter* limiter)
+	: route_in_flight { route_in_flight }
+	, limiter { limiter }
+	, start { std::chrono::steady_clock::now() }
+{
+}
+
+AdmissionController::Permit::Permit(Permit&& other) noexcept
+	: route_in_flight { std::exchange(other.route_in_flight, nullptr) }
+	, limiter { std::exchange(other.limiter, nullptr) }
+	, start { other.start }
+{
+}
+
+AdmissionController::Permit::~Permit()
+{
+	if (route_in_flight) {
+		route_in_flight->fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	release_class_slot();
+}
+
+void
+AdmissionController::Permit::release_class_slot()
+{
+	if (limiter) {
+		std::exchange(limiter, nullptr)->release(std::chrono::steady_clock::now() - start);
+	}
+}
+
+AdmissionController::Route::Route(std::string path, Priority priority, std::size_t max_in_flight)
+	: path { std::move(path) }
+	, priority { priority }
+	, max_in_flight { max_in_flight }
+{
+}
+
+AdmissionController::AdmissionController(std::size_t workers)
+{
+	workers = std::max<std::size_t>(workers, 2);
+
+	// bulk listings never hold more than half of the workers, running or waiting, so the high priority class always has threads left
+	limiters.try_emplace(Priority::HIGH, AdaptiveLimiter::Config {
+		.min_limit = 1,
+		.max_limit = workers,
+		.initial_limit = workers,
+		.max_queued = workers,
+		.max_threads = workers,
+		.max_wait = std::chrono::milliseconds(50),
+		.target_latency = std::chrono::milliseconds(10),
+	});
+
+	limiters.try_emplace(Priority::LOW, AdaptiveLimiter::Config {
+		.min_limit = 1,
+		.max_limit = workers / 2,
+		.initial_limit = workers / 2,
+		.max_queued = workers / 2,
+		.max_threads = workers / 2,
+		.max_wait = std::chrono::milliseconds(10),
+		.target_latency = std::chrono::milliseconds(250),
+	});
+}
+
+AdmissionController::RouteId
+AdmissionController::add_route(std::string path, Priority priority, std::size_t max_in_flight)
+{
+	routes.emplace_back(std::move(path), priority, max_in_flight);
+	return routes.size() - 1;
+}
+
+std::optional<AdmissionController::Permit>
+AdmissionController::try_admit(RouteId id)
+{
+	auto& route = routes.at(id);
+
+	std::atomic<std::size_t>* route_in_flight = nullptr;
+	if (route.max_in_flight != 0) {
+		if (route.in_flight.fetch_add(1, std::memory_order_relaxed) >= route.max_in_flight) {
+			route.in_flight.fetch_sub(1, std::memory_order_relaxed);
+			return std::nullopt;
+		}
+
+		route_in_flight = &route.in_flight;
+	}
+
+	auto& limiter = limiters.at(route.priority);
+	if (!limiter.acquire()) {
+		if (route_in_flight) {
+			route_in_flight->fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		return std::nullopt;
+	}
+
+	return Permit(route_in_flight, &limiter);
+}
+
+std::chrono::seconds
+AdmissionController::retry_after() const
+{
+	return std::chrono::seconds(1);
+}
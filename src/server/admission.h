@@ -0,0 +1,123 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace tser
+{
+	/// @brief Priority classes; each class has its own concurrency budget, so bulk work cannot starve the rest
+	enum class Priority
+	{
+		HIGH,	// lookups, mutations, simulation
+		LOW,	// bulk listings
+	};
+
+	/// @brief Concurrency limit which adapts to the measured handler latency (AIMD)
+	class AdaptiveLimiter
+	{
+	public:
+		struct Config
+		{
+			std::size_t min_limit = 1;
+			std::size_t max_limit = 64;
+			std::size_t initial_limit = 8;
+			std::size_t max_queued = 16;
+
+			/// @brief Bound for the threads held by the class, running or waiting; waiting blocks a worker thread too
+			std::size_t max_threads = 64;
+			std::chrono::milliseconds max_wait {50};
+			std::chrono::milliseconds target_latency {20};
+			double backoff = 0.9;
+		};
+
+		AdaptiveLimiter() = default;
+
+		explicit AdaptiveLimiter(Config config);
+
+		/// @brief Takes a slot; if none is free, waits in a bounded queue for at most max_wait
+		/// The caller's thread blocks meanwhile, so it only waits while the class is below max_threads
+		/// @return false if the request should be shed
+		bool acquire();
+
+		/// @brief Gives back a slot and adjusts the limit based on how long the request took
+		void release(std::chrono::nanoseconds latency);
+
+		std::size_t limit() const;
+
+		std::size_t in_flight() const;
+
+	private:
+		Config config;
+		std::mutex mutable mutex;
+		std::condition_variable cv;
+		double current_limit {static_cast<double>(config.initial_limit)};
+		std::size_t in_flight_count {0};
+		std::size_t queued {0};
+	};
+
+	/// @brief Decides whether a request is handled or rejected, based on per-route and per-class limits
+	class AdmissionController
+	{
+	public:
+		using RouteId = std::size_t;
+
+		/// @brief Held for the duration of a request; releases its slots on destruction
+		class Permit
+		{
+		public:
+			Permit(const Permit&) = delete;
+			Permit& operator=(const Permit&) = delete;
+			Permit(Permit&& other) noexcept;
+			Permit& operator=(Permit&&) = delete;
+			~Permit();
+
+			/// @brief Ends the class slot and its latency sample early, while the route slot is kept until destruction
+			/// For responses which keep streaming after the handler returned, so client download time is not taken as handler latency
+			void release_class_slot();
+
+		private:
+			friend class AdmissionController;
+
+			Permit(std::atomic<std::size_t>* route_in_flight, AdaptiveLimiter* limiter);
+
+			std::atomic<std::size_t>* route_in_flight;
+			AdaptiveLimiter* limiter;
+			std::chrono::steady_clock::time_point start;
+		};
+
+		/// @brief Creates the class limiters, sized for the given number of workers
+		explicit AdmissionController(std::size_t workers);
+
+		/// @brief Registers a route; must be called before serving requests
+		/// @param max_in_flight - per-route limit, 0 means the class limit only
+		RouteId add_route(std::string path, Priority priority, std::size_t max_in_flight = 0);
+
+		/// @brief Attempts to admit a request for the given route
+		std::optional<Permit> try_admit(RouteId route);
+
+		/// @brief Hint for clients whose requests were shed
+		std::chrono::seconds retry_after() const;
+
+	private:
+		struct Route
+		{
+			Route(std::string path, Priority priority, std::size_t max_in_flight);
+
+			std::string path;
+			Priority priority;
+			std::size_t max_in_flight;
+			std::atomic<std::size_t> in_flight {0};
+		};
+
+		std::deque<Route> routes;
+		std::unordered_map<Priority, AdaptiveLimiter> limiters;
+	};
+}
@@ -0,0 +1,406 @@
+#include "analytics.h"
+
+#include <algorithm>
+#include <bit>
+#include <future>
+#include <utility>
+
+using namespace tser;
+
+namespace
+{
+	constexpr std::size_t snapshot_chunk_size = 4096;
+	constexpr std::size_t word_bits = 64;
+
+	std::size_t
+	words_for(std::size_t bits)
+	{
+		return (bits + word_bits - 1) / word_bits;
+	}
+
+	/// @brief Splits [0, count) in contiguous ranges and runs fn(begin, end) for each of them on its own thread
+	void
+	parallel_for(std::size_t count, std::size_t workers, auto&& fn)
+	{
+		if (count == 0) {
+			return;
+		}
+
+		const auto tasks = std::clamp<std::size_t>(count / 256, 1, workers);
+		const auto per_task = (count + tasks - 1) / tasks;
+
+		std::vector<std::future<void>> futures;
+		for (std::size_t begin = 0; begin < count; begin += per_task) {
+			futures.push_back(std::async(std::launch::async, [&fn, begin, end = std::min(begin + per_task, count)] {
+				fn(begin, end);
+			}));
+		}
+
+		for (auto& future : futures) {
+			future.get();
+		}
+	}
+
+	/// @brief popcount(a & b); plain scalar loop over words, one popcount per word
+	std::size_t
+	and_popcount(const std::uint64_t* a, const std::uint64_t* b, std::size_t words)
+	{
+		std::size_t count = 0;
+		for (std::size_t i = 0; i < words; ++i) {
+			count += static_cast<std::size_t>(std::popcount(a[i] & b[i]));
+		}
+
+		return count;
+	}
+
+	std::size_t
+	popcount(const std::uint64_t* a, std::size_t words)
+	{
+		std::size_t count = 0;
+		for (std::size_t i = 0; i < words; ++i) {
+			count += static_cast<std::size_t>(std::popcount(a[i]));
+		}
+
+		return count;
+	}
+
+	/// @brief Keeps the limit highest counts, ties ordered by uuid so that results are stable
+	std::vector<Analytics::Ranked>
+	top(const std::vector<std::size_t>& counts, const std::vector<std::size_t>& roles, const std::vector<Role::Uuid>& uuids, std::size_t limit)
+	{
+		std::vector<std::pair<std::size_t, std::size_t>> ranked;
+		for (std::size_t i = 0; i < counts.size(); ++i) {
+			if (counts[i] != 0) {
+				ranked.emplace_back(counts[i], roles[i]);
+			}
+		}
+
+		const auto cmp = [&](const auto& a, const auto& b) {
+			return a.first != b.first ? a.first > b.first : uuids[a.second] < uuids[b.second];
+		};
+
+		const auto middle = ranked.begin() + std::min(limit, ranked.size());
+		std::partial_sort(ranked.begin(), middle, ranked.end(), cmp);
+		ranked.erase(middle, ranked.end());
+
+		std::vector<Analytics::Ranked> result;
+		result.reserve(ranked.size());
+		for (const auto& [count, role] : ranked) {
+			result.push_back({ uuids[role], count });
+		}
+
+		return result;
+	}
+}
+
+RepositoryResult<Analytics>
+Analytics::build(const IRepository& repository, std::size_t workers, std::size_t max_bits)
+{
+	Analytics analytics;
+	analytics.workers = std::max<std::size_t>(workers, 1);
+
+	// copy the ids out of each chunk, the roles are only valid until the next one is read
+	auto snapshot = repository.snapshot();
+	std::vector<std::vector<Role::Uuid>> subroles;
+	for (auto chunk = snapshot->next(snapshot_chunk_size); !chunk.empty(); chunk = snapshot->next(snapshot_chunk_size)) {
+		for (const auto* role : chunk) {
+			analytics.index.emplace(role->uuid, analytics.uuids.size());
+			analytics.uuids.push_back(role->uuid);
+			subroles.emplace_back(role->subroles().begin(), role->subroles().end());
+		}
+	}
+
+	// release the pinned shards before the matrices are built
+	snapshot.reset();
+
+	// direct inclusions by index; anything granted transitively is included directly by some role, so the columns are complete
+	std::vector<std::vector<std::size_t>> direct(subroles.size());
+	for (std::size_t i = 0; i < subroles.size(); ++i) {
+		for (const auto& subrole : subroles[i]) {
+			const auto it = analytics.index.find(subrole);
+			if (it == analytics.index.end()) {
+				continue;
+			}
+
+			direct[i].push_back(it->second);
+			if (analytics.col_of.try_emplace(it->second, analytics.col_roles.size()).second) {
+				analytics.col_roles.push_back(it->second);
+			}
+		}
+
+		if (!direct[i].empty()) {
+			analytics.row_of.emplace(i, analytics.row_roles.size());
+			analytics.row_roles.push_back(i);
+		}
+	}
+	subroles = {};
+
+	const auto rows = analytics.row_roles.size();
+	const auto cols = analytics.col_roles.size();
+	analytics.grants_words = words_for(cols);
+	analytics.parents_words = words_for(rows);
+
+	// checked before allocating; rows * words may itself overflow
+	const auto max_words = words_for(max_bits);
+	if ((analytics.grants_words != 0 && rows > max_words / analytics.grants_words)
+		|| (analytics.parents_words != 0 && cols > max_words / analytics.parents_words)) {
+		return std::unexpected(RepositoryErr::ANALYTICS_TOO_LARGE);
+	}
+
+	analytics.grants.assign(rows * analytics.grants_words, 0);
+	analytics.parents.assign(cols * analytics.parents_words, 0);
+
+	parallel_for(rows, analytics.workers, [&](std::size_t begin, std::size_t end) {
+		for (auto row = begin; row < end; ++row) {
+			auto* bits = analytics.grants.data() + row * analytics.grants_words;
+			for (const auto sub : direct[analytics.row_roles[row]]) {
+				const auto col = analytics.col_of.at(sub);
+				bits[col / word_bits] |= Word{1} << (col % word_bits);
+			}
+		}
+	});
+
+	// transitive closure: OR in the rows of the included roles, included roles first
+	std::vector<std::size_t> order;
+	std::vector<char> state(rows, 0);
+	for (std::size_t start = 0; start < rows; ++start) {
+		if (state[start]) {
+			continue;
+		}
+
+		std::vector<std::pair<std::size_t, std::size_t>> stack { { start, 0 } };
+		state[start] = 1;
+		while (!stack.empty()) {
+			auto& [row, next] = stack.back();
+			const auto& subs = direct[analytics.row_roles[row]];
+
+			if (next == subs.size()) {
+				order.push_back(row);
+				stack.pop_back();
+				continue;
+			}
+
+			const auto it = analytics.row_of.find(subs[next++]);
+			if (it != analytics.row_of.end() && !state[it->second]) {
+				state[it->second] = 1;
+				stack.emplace_back(it->second, 0);
+			}
+		}
+	}
+
+	for (const auto row : order) {
+		auto* bits = analytics.grants.data() + row * analytics.grants_words;
+		for (const auto sub : direct[analytics.row_roles[row]]) {
+			if (const auto it = analytics.row_of.find(sub); it != analytics.row_of.end()) {
+				const auto* sub_bits = analytics.grants_row(it->second);
+				for (std::size_t w = 0; w < analytics.grants_words; ++w) {
+					bits[w] |= sub_bits[w];
+				}
+			}
+		}
+	}
+
+	// transpose; each task owns whole words of the parents rows, i.e. blocks of 64 rows
+	parallel_for(analytics.parents_words, analytics.workers, [&](std::size_t begin, std::size_t end) {
+		for (auto row = begin * word_bits; row < std::min(end * word_bits, rows); ++row) {
+			const auto* bits = analytics.grants_row(row);
+			for (std::size_t w = 0; w < analytics.grants_words; ++w) {
+				for (auto word = bits[w]; word != 0; word &= word - 1) {
+					const auto col = w * word_bits + static_cast<std::size_t>(std::countr_zero(word));
+					analytics.parents[col * analytics.parents_words + row / word_bits] |= Word{1} << (row % word_bits);
+				}
+			}
+		}
+	});
+
+	return analytics;
+}
+
+RepositoryResult<std::vector<Analytics::Ranked>>
+Analytics::overlap(const Role::Uuid& role, std::size_t limit) const
+{
+	const auto it = index.find(role);
+	if (it == index.end()) {
+		return std::unexpected(RepositoryErr::ROLE_NOT_FOUND);
+	}
+
+	const auto own = row_of.find(it->second);
+	if (own == row_of.end()) {
+		return std::vector<Ranked>{};
+	}
+
+	const auto* bits = grants_row(own->second);
+	std::vector<std::size_t> counts(row_roles.size(), 0);
+
+	parallel_for(row_roles.size(), workers, [&](std::size_t begin, std::size_t end) {
+		for (auto row = begin; row < end; ++row) {
+			counts[row] = and_popcount(bits, grants_row(row), grants_words);
+		}
+	});
+
+	counts[own->second] = 0;
+	return top(counts, row_roles, uuids, limit);
+}
+
+std::vector<Analytics::Ranked>
+Analytics::impact(std::size_t limit) const
+{
+	std::vector<std::size_t> counts(col_roles.size(), 0);
+
+	parallel_for(col_roles.size(), workers, [&](std::size_t begin, std::size_t end) {
+		for (auto col = begin; col < end; ++col) {
+			counts[col] = popcount(parents_row(col), parents_words);
+		}
+	});
+
+	return top(counts, col_roles, uuids, limit);
+}
+
+RepositoryResult<std::vector<Role::Uuid>>
+Analytics::common_parents(const std::vector<Role::Uuid>& roles) const
+{
+	// every role has to exist, even once the answer is known to be empty
+	std::vector<const Word*> rows;
+	bool granted = true;
+
+	for (const auto& role : roles) {
+		const auto it = index.find(role);
+		if (it == index.end()) {
+			return std::unexpected(RepositoryErr::ROLE_NOT_FOUND);
+		}
+
+		const auto col = col_of.find(it->second);
+		if (col == col_of.end()) {
+			granted = false;
+		}
+		else {
+			rows.push_back(parents_row(col->second));
+		}
+	}
+
+	if (!granted) {
+		return std::vector<Role::Uuid>{};
+	}
+
+	std::vector<Word> common;
+	for (const auto* bits : rows) {
+		if (common.empty()) {
+			common.assign(bits, bits + parents_words);
+		}
+		else {
+			for (std::size_t w = 0; w < parents_words; ++w) {
+				common[w] &= bits[w];
+			}
+		}
+	}
+
+	std::vector<Role::Uuid> result;
+	for (std::size_t w = 0; w < common.size(); ++w) {
+		for (auto word = common[w]; word != 0; word &= word - 1) {
+			result.push_back(uuids[row_roles[w * word_bits + static_cast<std::size_t>(std::countr_zero(word))]]);
+		}
+	}
+
+	return result;
+}
+
+void
+tser::to_json(nlohmann::json& j, const Analytics::Ranked& ranked)
+{
+	j = nlohmann::json{
+		{"id", ranked.uuid},
+		{"count", ranked.count},
+	};
+}
+
+std::size_t
+Analytics::role_count() const
+{
+	return uuids.size();
+}
+
+const Analytics::Word*
+Analytics::grants_row(std::size_t row) const
+{
+	return grants.data() + row * grants_words;
+}
+
+const Analytics::Word*
+Analytics::parents_row(std::size_t col) const
+{
+	return parents.data() + col * parents_words;
+}
+
+AnalyticsCache::AnalyticsCache(std::shared_ptr<IRepository> repository, std::size_t workers, std::chrono::milliseconds max_staleness)
+	: repository { std::move(repository) }
+	, workers { workers }
+	, max_staleness { max_staleness }
+{
+}
+
+RepositoryResult<std::shared_ptr<const Analytics>>
+AnalyticsCache::get()
+{
+	{
+		std::scoped_lock lk{ mutex };
+		if (is_current(std::chrono::steady_clock::now())) {
+			return served();
+		}
+	}
+
+	std::unique_lock build_lk{ build_mutex, std::try_to_lock };
+	if (!build_lk.owns_lock()) {
+		// a build is running; answer from the previous engine rather than queue behind it
+		{
+			std::scoped_lock lk{ mutex };
+			if (analytics) {
+				return analytics;
+			}
+		}
+
+		build_lk.lock();
+	}
+
+	// another request may have rebuilt it while this one waited
+	{
+		std::scoped_lock lk{ mutex };
+		if (is_current(std::chrono::steady_clock::now())) {
+			return served();
+		}
+	}
+
+	// read before the build, so that changes made during the build trigger the next one
+	const auto version = repository->version();
+	const auto started = std::chrono::steady_clock::now();
+	auto built = Analytics::build(*repository, workers);
+
+	std::scoped_lock lk{ mutex };
+	if (built) {
+		analytics = std::make_shared<const Analytics>(std::move(built).value());
+		error = RepositoryErr::OK;
+	}
+	else {
+		analytics.reset();
+		error = built.error();
+	}
+	built_version = version;
+	built_at = started;
+
+	return served();
+}
+
+bool
+AnalyticsCache::is_current(std::chrono::steady_clock::time_point now) const
+{
+	return (analytics || error != RepositoryErr::OK) && (built_version == repository->version() || now - built_at < max_staleness);
+}
+
+RepositoryResult<std::shared_ptr<const Analytics>>
+AnalyticsCache::served() const
+{
+	if (!analytics) {
+		return std::unexpected(error);
+	}
+
+	return analytics;
+}
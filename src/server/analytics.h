@@ -0,0 +1,112 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// json
+#include <nlohmann/json.hpp>
+
+// proj
+#include "repository.h"
+
+namespace tser
+{
+	/// @brief Answers whole-graph questions over the granted roles, i.e. those included directly or through inclusions
+	/// Built once from a consistent snapshot as packed bitsets; each query then runs AND/popcount kernels across cores
+	class Analytics
+	{
+	public:
+		struct Ranked
+		{
+			Role::Uuid uuid;
+			std::size_t count;
+		};
+
+		// 2^32 bits, i.e. 512 MiB for each of the two matrices
+		static constexpr std::size_t default_max_bits = std::size_t{1} << 32;
+
+		/// @brief Builds the bitsets from a snapshot of the repository; writers are not blocked meanwhile
+		/// @param workers - number of threads used by the build and by the queries
+		/// @param max_bits - bound for the bits of each matrix, i.e. granting roles times granted roles
+		/// @return ANALYTICS_TOO_LARGE when the matrices would exceed max_bits
+		static RepositoryResult<Analytics> build(const IRepository& repository, std::size_t workers, std::size_t max_bits = default_max_bits);
+
+		/// @brief Roles sharing the most granted roles with the given role
+		RepositoryResult<std::vector<Ranked>> overlap(const Role::Uuid& role, std::size_t limit) const;
+
+		/// @brief Granted roles with the largest blast radius, i.e. granted by the most roles
+		std::vector<Ranked> impact(std::size_t limit) const;
+
+		/// @brief Roles which grant all of the given roles
+		RepositoryResult<std::vector<Role::Uuid>> common_parents(const std::vector<Role::Uuid>& roles) const;
+
+		std::size_t role_count() const;
+
+	private:
+		using Word = std::uint64_t;
+
+		Analytics() = default;
+
+		// every role of the snapshot
+		std::vector<Role::Uuid> uuids;
+		std::unordered_map<Role::Uuid, std::size_t> index;
+
+		// rows: roles which grant something; columns: roles which are granted by something
+		std::vector<std::size_t> row_roles;
+		std::vector<std::size_t> col_roles;
+		std::unordered_map<std::size_t, std::size_t> row_of;
+		std::unordered_map<std::size_t, std::size_t> col_of;
+
+		// row-major bits: grants[row] has a bit for every column it grants; parents is its transpose
+		std::size_t grants_words = 0;
+		std::size_t parents_words = 0;
+		std::vector<Word> grants;
+		std::vector<Word> parents;
+
+		std::size_t workers = 1;
+
+		const Word* grants_row(std::size_t row) const;
+		const Word* parents_row(std::size_t col) const;
+	};
+
+	/// @brief Keeps one built Analytics for the server, so that queries do not each pay for a build
+	/// The engine is rebuilt once the repository changed and the engine is older than max_staleness;
+	/// until then, queries are answered from the previous build
+	class AnalyticsCache
+	{
+	public:
+		AnalyticsCache(std::shared_ptr<IRepository> repository, std::size_t workers, std::chrono::milliseconds max_staleness);
+
+		/// @brief The current engine; builds it on first use or when it is out of date, one build at a time
+		/// While a build runs, other callers are answered from the previous engine instead of waiting for it
+		/// @return the error of the last build when it failed, e.g. ANALYTICS_TOO_LARGE
+		RepositoryResult<std::shared_ptr<const Analytics>> get();
+
+	private:
+		bool is_current(std::chrono::steady_clock::time_point now) const;
+		RepositoryResult<std::shared_ptr<const Analytics>> served() const;
+
+		std::shared_ptr<IRepository> repository;
+		std::size_t workers;
+		std::chrono::milliseconds max_staleness;
+
+		// builds are serialized, so that at most one engine is being built next to the served one
+		std::mutex build_mutex;
+
+		std::mutex mutable mutex;
+		std::shared_ptr<const Analytics> analytics;
+		// set instead of analytics when the last build failed; kept for as long as an engine would be
+		RepositoryErr error = RepositoryErr::OK;
+		std::uint64_t built_version = 0;
+		std::chrono::steady_clock::time_point built_at;
+	};
+
+	void to_json(nlohmann::json& j, const Analytics::Ranked& ranked);
+}
@@ -0,0 +1,71 @@
+#include "compactor.h"
+
+#include <utility>
+
+using namespace tser;
+
+Compactor::Compactor(std::shared_ptr<IRepository> repository, Config config)
+	: repository { std::move(repository) }
+	, config { config }
+	, thread { [this](std::stop_token stop) { run(stop); } }
+{
+}
+
+void
+Compactor::trigger()
+{
+	{
+		std::scoped_lock lk{ mutex };
+		triggered = true;
+	}
+
+	cv.notify_one();
+}
+
+std::pair<std::vector<MemoryUsage>, std::vector<MemoryUsage>>
+Compactor::compact_now()
+{
+	std::scoped_lock lk{ compaction_mutex };
+
+	auto before = repository->memory_usage();
+	repository->compact();
+
+	return { std::move(before), repository->memory_usage() };
+}
+
+bool
+Compactor::should_compact(const ChurnStats& churn) const
+{
+	return churn.removed >= config.min_removed
+		&& static_cast<double>(churn.removed) > config.removed_ratio * static_cast<double>(churn.live);
+}
+
+void
+Compactor::run(std::stop_token stop)
+{
+	while (!stop.stop_requested()) {
+		{
+			std::unique_lock lk{ mutex };
+			cv.wait_for(lk, stop, config.interval, [this] { return triggered; });
+			triggered = false;
+		}
+
+		if (stop.stop_requested()) {
+			return;
+		}
+
+		std::scoped_lock lk{ compaction_mutex };
+		if (should_compact(repository->churn())) {
+			repository->compact();
+		}
+	}
+}
+
+void
+tser::to_json(nlohmann::json& j, const MemoryUsage& usage)
+{
+	j["structure"] = usage.structure;
+	j["elements"] = usage.elements;
+	j["bytes"] = usage.bytes;
+	j["slack_bytes"] = usage.slack_bytes;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// json
+#include <nlohmann/json.hpp>
+
+// proj
+#include "repository.h"
+
+namespace tser
+{
+	/// @brief Compacts a repository in the background once enough of it was removed since the last compaction
+	/// Runs every interval and whenever triggered; the check reads running counters only, so it never walks the repository under its lock
+	class Compactor
+	{
+	public:
+		struct Config
+		{
+			std::chrono::seconds interval = std::chrono::seconds(60);
+
+			/// @brief Compacts only once the removed elements exceed both this share of the live ones and min_removed
+			double removed_ratio = 0.5;
+			std::size_t min_removed = 100'000;
+		};
+
+		Compactor(std::shared_ptr<IRepository> repository, Config config);
+
+		/// @brief Wakes the background thread; it compacts only if the thresholds are met
+		void trigger();
+
+		/// @brief Compacts right away on the calling thread, regardless of the thresholds
+		/// @returns the memory usage before and after
+		std::pair<std::vector<MemoryUsage>, std::vector<MemoryUsage>> compact_now();
+
+		/// @brief Whether the churn calls for a compaction under the configured thresholds
+		bool should_compact(const ChurnStats& churn) const;
+
+	private:
+		void run(std::stop_token stop);
+
+		std::shared_ptr<IRepository> repository;
+		Config config;
+
+		// a single compaction at a time, whether triggered or requested
+		std::mutex compaction_mutex;
+
+		std::mutex mutex;
+		std::condition_variable_any cv;
+		bool triggered = false;
+
+		// last, so that the thread is stopped before the rest goes away
+		std::jthread thread;
+	};
+
+	void to_json(nlohmann::json& j, const MemoryUsage& usage);
+}
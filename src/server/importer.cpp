@@ -0,0 +1,256 @@
+#include "importer.h"
+
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <utility>
+
+using namespace tser;
+
+namespace
+{
+	constexpr std::size_t batch_size = 16384;
+	constexpr std::size_t min_lines_per_task = 1024;
+
+	struct ParsedRole
+	{
+		std::size_t line;
+		Role role;
+	};
+
+	struct ParsedChunk
+	{
+		std::vector<ParsedRole> roles;
+		std::vector<ImportSummary::Error> errors;
+	};
+
+	std::vector<std::string_view>
+	split_lines(std::string_view body)
+	{
+		std::vector<std::string_view> lines;
+		while (!body.empty()) {
+			const auto end = body.find('\n');
+			lines.push_back(body.substr(0, end));
+			body.remove_prefix(end == std::string_view::npos ? body.size() : end + 1);
+		}
+
+		return lines;
+	}
+
+	ParsedChunk
+	parse_chunk(std::span<const std::string_view> lines, std::size_t first_line)
+	{
+		ParsedChunk chunk;
+		chunk.roles.reserve(lines.size());
+
+		for (std::size_t i = 0; i < lines.size(); ++i) {
+			const auto line = lines[i];
+			if (line.find_first_not_of(" \t\r") == std::string_view::npos) {
+				continue;
+			}
+
+			try {
+				chunk.roles.push_back({ first_line + i, Role::parse(line) });
+			}
+			catch (std::exception& e) {
+				chunk.errors.push_back({ first_line + i, e.what() });
+			}
+		}
+
+		return chunk;
+	}
+
+	/// @brief Order in which the edges can be applied: a role only gains subroles once it was included itself,
+	/// so every edge into a role comes before the edges out of it; edges on cycles go last, in line order
+	std::vector<std::size_t>
+	edge_order(const std::vector<std::pair<Role::Uuid, Role::Uuid>>& edges)
+	{
+		std::unordered_map<std::string_view, std::size_t> ids;
+		const auto id = [&](const Role::Uuid& uuid) {
+			return ids.try_emplace(uuid, ids.size()).first->second;
+		};
+
+		std::vector<std::pair<std::size_t, std::size_t>> links;
+		links.reserve(edges.size());
+		for (const auto& [role, subrole] : edges) {
+			const auto from = id(role);
+			links.emplace_back(from, id(subrole));
+		}
+
+		// Kahn's algorithm over the roles; rank is the position in a topological order
+		std::vector<std::vector<std::size_t>> out(ids.size());
+		std::vector<std::size_t> in_degree(ids.size());
+		for (const auto& [from, to] : links) {
+			out[from].push_back(to);
+			++in_degree[to];
+		}
+
+		std::vector<std::size_t> ready;
+		for (std::size_t node = 0; node < ids.size(); ++node) {
+			if (in_degree[node] == 0) {
+				ready.push_back(node);
+			}
+		}
+
+		std::vector<std::size_t> rank(ids.size(), std::numeric_limits<std::size_t>::max());
+		for (std::size_t next = 0; !ready.empty(); ++next) {
+			const auto node = ready.back();
+			ready.pop_back();
+			rank[node] = next;
+
+			for (const auto to : out[node]) {
+				if (--in_degree[to] == 0) {
+					ready.push_back(to);
+				}
+			}
+		}
+
+		std::vector<std::size_t> order(edges.size());
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+
+		std::ranges::stable_sort(order, {}, [&](std::size_t edge) { return rank[links[edge].first]; });
+		return order;
+	}
+
+	void
+	add_error(ImportSummary& summary, std::size_t line, std::string reason)
+	{
+		if (summary.errors.size() < ImportSummary::max_errors) {
+			summary.errors.push_back({ line, std::move(reason) });
+		}
+	}
+}
+
+void
+tser::to_json(nlohmann::json& j, const ImportSummary& summary)
+{
+	j = nlohmann::json{
+		{"accepted", summary.accepted},
+		{"rejected", summary.rejected},
+		{"edgesAccepted", summary.edges_accepted},
+		{"edgesRejected", summary.edges_rejected},
+		{"errors", nlohmann::json::array()},
+	};
+
+	for (const auto& error : summary.errors) {
+		j["errors"].push_back({
+			{"line", error.line},
+			{"reason", error.reason},
+		});
+	}
+}
+
+ImportSummary
+tser::import_ndjson(IRepository& repository, std::string_view body, std::size_t workers)
+{
+	ImportSummary summary;
+
+	// parse
+	const auto lines = split_lines(body);
+	const auto tasks = std::clamp<std::size_t>(lines.size() / min_lines_per_task, 1, std::max<std::size_t>(workers, 1));
+	const auto per_task = (lines.size() + tasks - 1) / tasks;
+
+	std::vector<std::future<ParsedChunk>> futures;
+	for (std::size_t first = 0; first < lines.size(); first += per_task) {
+		const auto count = std::min(per_task, lines.size() - first);
+		futures.push_back(std::async(std::launch::async, parse_chunk, std::span(lines).subspan(first, count), first + 1));
+	}
+
+	// insert roles in batches; the included roles are kept aside until all roles exist
+	std::vector<std::pair<Role::Uuid, Role::Uuid>> edges;
+	std::vector<std::size_t> edge_lines;
+
+	std::vector<Role> batch;
+	std::vector<ParsedRole*> batch_sources;
+
+	const auto flush = [&] {
+		const auto results = repository.add_roles(std::move(batch));
+		for (std::size_t i = 0; i < results.size(); ++i) {
+			auto& source = *batch_sources[i];
+			if (results[i] != RepositoryErr::OK) {
+				++summary.rejected;
+				add_error(summary, source.line, std::string(repository.err_to_str(results[i])));
+				continue;
+			}
+
+			++summary.accepted;
+			for (const auto& subrole : source.role.subroles()) {
+				edges.emplace_back(source.role.uuid, subrole);
+				edge_lines.push_back(source.line);
+			}
+		}
+
+		batch.clear();
+		batch_sources.clear();
+	};
+
+	std::vector<ParsedChunk> chunks;
+	chunks.reserve(futures.size());
+	for (auto& future : futures) {
+		auto& chunk = chunks.emplace_back(future.get());
+
+		summary.rejected += chunk.errors.size();
+		for (auto& error : chunk.errors) {
+			add_error(summary, error.line, std::move(error.reason));
+		}
+
+		for (auto& parsed : chunk.roles) {
+			batch.emplace_back(std::move(parsed.role.name), parsed.role.uuid);
+			batch_sources.push_back(&parsed);
+
+			if (batch.size() == batch_size) {
+				flush();
+			}
+		}
+	}
+
+	flush();
+
+	// apply inclusions, parents' own inclusions first
+	const auto order = edge_order(edges);
+
+	std::vector<std::pair<Role::Uuid, Role::Uuid>> ordered_edges;
+	std::vector<std::size_t> ordered_lines;
+	ordered_edges.reserve(edges.size());
+	ordered_lines.reserve(edges.size());
+	for (const auto i : order) {
+		ordered_edges.push_back(std::move(edges[i]));
+		ordered_lines.push_back(edge_lines[i]);
+	}
+
+	edges = std::move(ordered_edges);
+	edge_lines = std::move(ordered_lines);
+
+	for (std::size_t first = 0; first < edges.size(); first += batch_size) {
+		const auto last = std::min(first + batch_size, edges.size());
+		const auto results = repository.include_roles({ edges.begin() + first, edges.begin() + last });
+
+		for (std::size_t i = 0; i < results.size(); ++i) {
+			if (results[i] != RepositoryErr::OK) {
+				++summary.edges_rejected;
+				add_error(summary, edge_lines[first + i], edges[first + i].second + ": " + std::string(repository.err_to_str(results[i])));
+			}
+			else {
+				++summary.edges_accepted;
+			}
+		}
+	}
+
+	return summary;
+}
+
+std::string
+tser::export_ndjson(IRoleSnapshot& snapshot, std::size_t max_roles)
+{
+	std::string chunk;
+	for (const auto* role : snapshot.next(max_roles)) {
+		chunk += nlohmann::json(*role).dump();
+		chunk += '\n';
+	}
+
+	return chunk;
+}
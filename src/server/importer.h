@@ -0,0 +1,47 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// json
+#include <nlohmann/json.hpp>
+
+// proj
+#include "repository.h"
+
+namespace tser
+{
+	/// @brief Outcome of a bulk import
+	struct ImportSummary
+	{
+		struct Error
+		{
+			std::size_t line;
+			std::string reason;
+		};
+
+		/// @brief Only the first errors are reported; the counters cover all of them
+		static constexpr std::size_t max_errors = 100;
+
+		std::size_t accepted = 0;
+		std::size_t rejected = 0;
+		std::size_t edges_accepted = 0;
+		std::size_t edges_rejected = 0;
+		std::vector<Error> errors;
+	};
+
+	void to_json(nlohmann::json& j, const ImportSummary& summary);
+
+	/// @brief Imports newline-delimited role JSON into a repository
+	/// Lines are parsed in parallel, roles are inserted in large batches and
+	/// their included roles are applied once all the roles are known
+	/// @param workers - upper bound for the number of parsing threads
+	ImportSummary import_ndjson(IRepository& repository, std::string_view body, std::size_t workers);
+
+	/// @brief Serializes the next roles of a snapshot as newline-delimited JSON, in the format import_ndjson accepts
+	/// @returns an empty string once the snapshot is exhausted
+	std::string export_ndjson(IRoleSnapshot& snapshot, std::size_t max_roles);
+}
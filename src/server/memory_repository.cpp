@@ -1,33 +1,259 @@
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
 #include "memory_repository.h"
 
 using namespace tser;
 
+namespace
+{
+	constexpr std::size_t compaction_batch_size = 1024;
+
+	std::uint64_t
+	uuid_hash(const Role::Uuid& uuid)
+	{
+		return static_cast<std::uint64_t>(std::hash<Role::Uuid>{}(uuid));
+	}
+
+	/// @brief First position at or after from whose hash is not less than value; probes 1, 2, 4, ... ahead, then bisects
+	std::size_t
+	gallop(const std::vector<std::uint64_t>& hashes, std::size_t from, std::uint64_t value)
+	{
+		std::size_t step = 1;
+		auto low = from;
+		auto high = from;
+		while (high < hashes.size() && hashes[high] < value) {
+			low = high + 1;
+			high = from + step;
+			step *= 2;
+		}
+
+		const auto last = std::min(high, hashes.size());
+		return static_cast<std::size_t>(std::lower_bound(hashes.begin() + low, hashes.begin() + last, value) - hashes.begin());
+	}
+
+	/// @brief Weight of an expansion against the cache bound; at least 1, so that leaf roles are evicted too
+	std::size_t
+	cache_charge(const auto& expansion)
+	{
+		return std::max<std::size_t>(1, expansion.uuids.size());
+	}
+
+	// memory accounting; estimates from the container capacities, for the layout of the standard library in use
+#if defined(_MSC_VER)
+	// nodes live in a doubly linked list; the buckets are pairs of list iterators
+	constexpr std::size_t node_link_bytes = 2 * sizeof(void*);
+	constexpr std::size_t bucket_bytes = 2 * sizeof(void*);
+#else
+	// nodes hold a link and the cached hash; the buckets are single pointers
+	constexpr std::size_t node_link_bytes = sizeof(void*) + sizeof(std::size_t);
+	constexpr std::size_t bucket_bytes = sizeof(void*);
+#endif
+
+	std::size_t
+	string_bytes(const std::string& s)
+	{
+		// short strings live inside the object
+		return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+	}
+
+	/// @brief Buckets and nodes of a hash table
+	void
+	add_table(MemoryUsage& usage, const auto& table)
+	{
+		using Value = typename std::remove_cvref_t<decltype(table)>::value_type;
+
+		usage.bytes += table.bucket_count() * bucket_bytes + table.size() * (sizeof(Value) + node_link_bytes);
+		if (table.bucket_count() > table.size()) {
+			usage.slack_bytes += (table.bucket_count() - table.size()) * bucket_bytes;
+		}
+	}
+
+	/// @brief Whether a hash table holds noticeably more buckets than its size needs
+	bool
+	has_slack(const auto& table)
+	{
+		return table.bucket_count() > 2 * table.size() + 16;
+	}
+}
+
+/// @brief Holds a reference to every shard; the shards it holds are never modified again
+class MemoryRepository::Snapshot : public IRoleSnapshot
+{
+public:
+	explicit Snapshot(std::array<std::shared_ptr<const Shard>, shard_count> shards)
+		: shards { std::move(shards) }
+		, it { this->shards.front()->begin() }
+	{
+	}
+
+	virtual std::vector<const Role*> next(std::size_t max_roles) override
+	{
+		// shards read up to the previous chunk are no longer referenced; let writers change them in place again
+		for (; released < index; ++released) {
+			shards[released].reset();
+		}
+
+		std::vector<const Role*> chunk;
+		chunk.reserve(max_roles);
+
+		while (index < shard_count && chunk.size() < max_roles) {
+			if (it == shards[index]->end()) {
+				if (++index < shard_count) {
+					it = shards[index]->begin();
+				}
+
+				continue;
+			}
+
+			chunk.push_back(&it->second);
+			++it;
+		}
+
+		return chunk;
+	}
+
+private:
+	std::array<std::shared_ptr<const Shard>, shard_count> shards;
+	std::size_t index = 0;
+	std::size_t released = 0;
+	Shard::const_iterator it;
+};
+
+MemoryRepository::MemoryRepository(std::size_t max_cached_grants)
+	: max_cached_grants { max_cached_grants }
+{
+	for (auto& shard : repository) {
+		shard = std::make_shared<Shard>();
+	}
+}
+
+std::size_t
+MemoryRepository::shard_index(const Role::Uuid& role)
+{
+	// fibonacci hashing; takes the top bits so that the shard's own buckets still see well spread hashes
+	const auto hash = static_cast<std::uint64_t>(std::hash<Role::Uuid>{}(role));
+	return static_cast<std::size_t>((hash * 0x9E3779B97F4A7C15ull) >> (64 - shard_bits));
+}
+
+const MemoryRepository::Shard&
+MemoryRepository::shard(const Role::Uuid& role) const
+{
+	return *repository[shard_index(role)];
+}
+
+MemoryRepository::Shard&
+MemoryRepository::mutable_shard(const Role::Uuid& role)
+{
+	auto& shard = repository[shard_index(role)];
+
+	// a snapshot still references the shard; leave it intact and continue on a copy
+	// snapshots are only taken under the shared lock, so the count cannot grow while we hold the exclusive one
+	if (shard.use_count() > 1) {
+		shard = std::make_shared<Shard>(*shard);
+	}
+	else {
+		// use_count is a relaxed load; synchronize with the release of the last snapshot before writing in place
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+
+	return *shard;
+}
+
+const Role*
+MemoryRepository::find(const Role::Uuid& role) const
+{
+	const auto& roles = shard(role);
+	const auto it = roles.find(role);
+
+	return it != roles.end() ? &it->second : nullptr;
+}
+
+Role*
+MemoryRepository::find_mutable(const Role::Uuid& role)
+{
+	if (!find(role)) {
+		return nullptr;
+	}
+
+	return &mutable_shard(role).at(role);
+}
+
 RepositoryErr
 MemoryRepository::add_role(Role role)
 {
 	std::unique_lock lk{ mutex };
-	if (repository.contains(role.uuid)) {
-		return RepositoryErr::ROLE_ALREADY_EXISTS;
-	}
-	else {
-		repository.insert({ role.uuid, std::move(role) });
+	return add_role_locked(std::move(role));
+}
+
+std::vector<RepositoryErr>
+MemoryRepository::add_roles(std::vector<Role> roles)
+{
+	std::vector<RepositoryErr> results;
+	results.reserve(roles.size());
+
+	std::unique_lock lk{ mutex };
+	for (auto& role : roles) {
+		results.push_back(add_role_locked(std::move(role)));
 	}
 
-	return RepositoryErr::OK;
+	return results;
 }
 
 std::unordered_map<Role::Uuid, Role>
 MemoryRepository::roles() const
 {
 	std::shared_lock lk{ mutex };
-	return repository;
+
+	std::size_t size = 0;
+	for (const auto& shard : repository) {
+		size += shard->size();
+	}
+
+	std::unordered_map<Role::Uuid, Role> roles;
+	roles.reserve(size);
+	for (const auto& shard : repository) {
+		roles.insert(shard->begin(), shard->end());
+	}
+
+	return roles;
+}
+
+std::unique_ptr<IRoleSnapshot>
+MemoryRepository::snapshot() const
+{
+	std::array<std::shared_ptr<const Shard>, shard_count> shards;
+
+	std::shared_lock lk{ mutex };
+	std::ranges::copy(repository, shards.begin());
+
+	return std::make_unique<Snapshot>(std::move(shards));
+}
+
+std::vector<Role>
+MemoryRepository::find_by_name(std::string_view prefix, std::size_t limit) const
+{
+	// copying the few matches is cheaper than pinning their shards, which would make writers copy whole shards
+	std::vector<Role> result;
+
+	std::shared_lock lk{ mutex };
+	for (auto it = names.lower_bound({ Role::Name(prefix), Role::Uuid() });
+		it != names.end() && it->first.starts_with(prefix) && result.size() < limit;
+		++it)
+	{
+		result.push_back(*find(it->second));
+	}
+
+	return result;
 }
 
 RepositoryResult<std::optional<std::unordered_set<Role::Uuid>>>
 MemoryRepository::dependencies(const Role::Uuid& subrole) const
 {
 	std::shared_lock lk{ mutex };
-	if (!repository.contains(subrole)) {
+	if (!find(subrole)) {
 		return std::unexpected(RepositoryErr::ROLE_NOT_FOUND);
 	}
 
@@ -39,6 +265,62 @@ MemoryRepository::dependencies(const Role::Uuid& subrole) const
 	return std::nullopt;
 }
 
+RepositoryResult<std::vector<Role::Uuid>>
+MemoryRepository::effective_subroles(const Role::Uuid& role) const
+{
+	std::shared_lock lk{ mutex };
+	const auto expanded = expansion(role);
+	if (!expanded) {
+		return std::unexpected(RepositoryErr::ROLE_NOT_FOUND);
+	}
+
+	return expanded->uuids;
+}
+
+std::vector<RepositoryResult<std::vector<Role::Uuid>>>
+MemoryRepository::check_subroles(const std::vector<std::pair<Role::Uuid, std::vector<Role::Uuid>>>& queries) const
+{
+	std::vector<RepositoryResult<std::vector<Role::Uuid>>> results;
+	results.reserve(queries.size());
+
+	std::vector<std::pair<std::uint64_t, const Role::Uuid*>> wanted;
+
+	std::shared_lock lk{ mutex };
+	for (const auto& [role, subroles] : queries) {
+		const auto expanded = expansion(role);
+		if (!expanded) {
+			results.push_back(std::unexpected(RepositoryErr::ROLE_NOT_FOUND));
+			continue;
+		}
+
+		wanted.clear();
+		for (const auto& subrole : subroles) {
+			wanted.emplace_back(uuid_hash(subrole), &subrole);
+		}
+		std::ranges::sort(wanted);
+
+		// galloping search over the sorted hashes: the queried subroles are usually few against a large expansion,
+		// so each one is found in time logarithmic in the distance from the previous one; equal hashes are confirmed on the uuids
+		const auto& hashes = expanded->hashes;
+		std::vector<Role::Uuid> granted;
+		std::size_t i = 0;
+		for (const auto& [want, subrole] : wanted) {
+			i = gallop(hashes, i, want);
+
+			for (auto k = i; k < hashes.size() && hashes[k] == want; ++k) {
+				if (expanded->uuids[k] == *subrole) {
+					granted.push_back(expanded->uuids[k]);
+					break;
+				}
+			}
+		}
+
+		results.push_back(std::move(granted));
+	}
+
+	return results;
+}
+
 RepositoryErr
 MemoryRepository::include_role(const Role::Uuid& role, const Role::Uuid& subrole)
 {
@@ -48,22 +330,96 @@ MemoryRepository::include_role(const Role::Uuid& role, const Role::Uuid& subrole
 
 	{
 		std::shared_lock lk{ mutex };
-		if (!repository.contains(role) || !repository.contains(subrole)) {
+		const auto* sub = find(subrole);
+		if (!find(role) || !sub) {
 			return RepositoryErr::ROLE_NOT_FOUND;
 		}
 
-		if (repository.at(subrole).has_subroles()) {
+		if (sub->has_subroles()) {
 			return RepositoryErr::ROLE_HAS_SUBROLE;
 		}
 	}
 
+	// the checks above only reject early; the subrole may have gained subroles since, so they are repeated
 	std::scoped_lock lk{ mutex };
-	if (!repository.contains(role)) {
+	return include_role_locked(role, subrole);
+}
+
+std::vector<RepositoryErr>
+MemoryRepository::include_roles(const std::vector<std::pair<Role::Uuid, Role::Uuid>>& edges)
+{
+	std::vector<RepositoryErr> results;
+	results.reserve(edges.size());
+
+	std::unique_lock lk{ mutex };
+	for (const auto& [role, subrole] : edges) {
+		results.push_back(include_role_locked(role, subrole));
+	}
+
+	return results;
+}
+
+RepositoryErr
+MemoryRepository::add_role_locked(Role role)
+{
+	if (find(role.uuid)) {
+		return RepositoryErr::ROLE_ALREADY_EXISTS;
+	}
+
+	// included roles follow the rules of include_role, so that deps stays complete
+	for (const auto& subrole : role.subroles()) {
+		if (subrole == role.uuid) {
+			return RepositoryErr::ILLEGAL_OP;
+		}
+
+		const auto* sub = find(subrole);
+		if (!sub) {
+			return RepositoryErr::ROLE_NOT_FOUND;
+		}
+
+		if (sub->has_subroles()) {
+			return RepositoryErr::ROLE_HAS_SUBROLE;
+		}
+	}
+
+	for (const auto& subrole : role.subroles()) {
+		deps[subrole].insert(role.uuid);
+	}
+
+	names.emplace(role.name, role.uuid);
+
+	auto uuid = role.uuid;
+	live_elements.fetch_add(1 + role.subroles().size(), std::memory_order_relaxed);
+	mutable_shard(uuid).try_emplace(std::move(uuid), std::move(role));
+	changes.fetch_add(1, std::memory_order_relaxed);
+	return RepositoryErr::OK;
+}
+
+RepositoryErr
+MemoryRepository::include_role_locked(const Role::Uuid& role, const Role::Uuid& subrole)
+{
+	if (role == subrole) {
+		return RepositoryErr::ILLEGAL_OP;
+	}
+
+	const auto* sub = find(subrole);
+	if (!find(role) || !sub) {
 		return RepositoryErr::ROLE_NOT_FOUND;
 	}
 
+	if (sub->has_subroles()) {
+		return RepositoryErr::ROLE_HAS_SUBROLE;
+	}
+
+	if (!find_mutable(role)->add_subrole(subrole)) {
+		return RepositoryErr::UNKNOWN_ERR;
+	}
+
+	invalidate_expansions(role);
 	deps[subrole].insert(role);
-	return repository[role].add_subrole(subrole) ? RepositoryErr::OK : RepositoryErr::UNKNOWN_ERR;
+	live_elements.fetch_add(1, std::memory_order_relaxed);
+	changes.fetch_add(1, std::memory_order_relaxed);
+	return RepositoryErr::OK;
 }
 
 RepositoryErr
@@ -71,23 +427,331 @@ MemoryRepository::exclude_role(const Role::Uuid& role, const Role::Uuid& subrole
 {
 	{
 		std::shared_lock lk{ mutex };
-		if (!repository.contains(role)) {
+		if (!find(role)) {
 			return RepositoryErr::ROLE_NOT_FOUND;
 		}
 	}
 
 	std::scoped_lock lk{ mutex };
-	if (!repository.contains(role)) {
+	auto* stored = find_mutable(role);
+	if (!stored) {
+		return RepositoryErr::ROLE_NOT_FOUND;
+	}
+
+	invalidate_expansions(role);
+	remove_dependency(subrole, role);
+	changes.fetch_add(1, std::memory_order_relaxed);
+	if (!stored->rem_subrole(subrole)) {
+		return RepositoryErr::UNKNOWN_ERR;
+	}
+
+	live_elements.fetch_sub(1, std::memory_order_relaxed);
+	removed_elements.fetch_add(1, std::memory_order_relaxed);
+	return RepositoryErr::OK;
+}
+
+RepositoryErr
+MemoryRepository::remove_role(const Role::Uuid& role, bool restrict)
+{
+	std::scoped_lock lk{ mutex };
+	const auto* stored = find(role);
+	if (!stored) {
 		return RepositoryErr::ROLE_NOT_FOUND;
 	}
 
-	deps[subrole].erase(role);
-	return repository.at(role).rem_subrole(subrole) ? RepositoryErr::OK : RepositoryErr::UNKNOWN_ERR;
+	const auto parents = deps.find(role);
+	if (restrict && parents != deps.end()) {
+		return RepositoryErr::ROLE_HAS_DEPENDENTS;
+	}
+
+	invalidate_expansions(role);
+	names.erase({ stored->name, role });
+
+	const auto removed = 1 + stored->subroles().size() + (parents != deps.end() ? parents->second.size() : 0);
+	live_elements.fetch_sub(removed, std::memory_order_relaxed);
+	removed_elements.fetch_add(removed, std::memory_order_relaxed);
+
+	// roles included by the removed one; done first, as updating the parents may copy the shard
+	for (const auto& subrole : stored->subroles()) {
+		remove_dependency(subrole, role);
+	}
+
+	// roles which include the removed one
+	if (parents != deps.end()) {
+		for (const auto& parent : parents->second) {
+			find_mutable(parent)->rem_subrole(role);
+		}
+
+		deps.erase(parents);
+	}
+
+	mutable_shard(role).erase(role);
+	changes.fetch_add(1, std::memory_order_relaxed);
+	return RepositoryErr::OK;
+}
+
+void
+MemoryRepository::remove_dependency(const Role::Uuid& subrole, const Role::Uuid& role)
+{
+	// drop emptied entries, so that the index only tracks the live graph
+	if (const auto it = deps.find(subrole); it != deps.end()) {
+		it->second.erase(role);
+		if (it->second.empty()) {
+			deps.erase(it);
+		}
+	}
+}
+
+std::shared_ptr<const MemoryRepository::Expansion>
+MemoryRepository::expansion(const Role::Uuid& role) const
+{
+	{
+		std::scoped_lock lk{ expansions_mutex };
+		if (const auto it = expansions.find(role); it != expansions.end()) {
+			return it->second;
+		}
+	}
+
+	const auto* stored = find(role);
+	if (!stored) {
+		return nullptr;
+	}
+
+	std::vector<std::pair<std::uint64_t, Role::Uuid>> granted;
+	std::unordered_set<Role::Uuid> visited;
+	std::vector<const Role*> pending { stored };
+
+	while (!pending.empty()) {
+		const auto* current = pending.back();
+		pending.pop_back();
+
+		for (const auto& subrole : current->subroles()) {
+			if (!visited.insert(subrole).second) {
+				continue;
+			}
+
+			granted.emplace_back(uuid_hash(subrole), subrole);
+			if (const auto* sub = find(subrole)) {
+				pending.push_back(sub);
+			}
+		}
+	}
+
+	std::ranges::sort(granted);
+
+	auto expanded = std::make_shared<Expansion>();
+	expanded->hashes.reserve(granted.size());
+	expanded->uuids.reserve(granted.size());
+	for (auto& [hash, uuid] : granted) {
+		expanded->hashes.push_back(hash);
+		expanded->uuids.push_back(std::move(uuid));
+	}
+
+	// an expansion larger than the whole cache is served uncached
+	const auto charge = cache_charge(*expanded);
+	if (charge > max_cached_grants) {
+		return expanded;
+	}
+
+	std::scoped_lock lk{ expansions_mutex };
+	while (cached_grants + charge > max_cached_grants) {
+		const auto victim = expansions.begin();
+		cached_grants -= cache_charge(*victim->second);
+		expansions.erase(victim);
+	}
+
+	if (expansions.try_emplace(role, expanded).second) {
+		cached_grants += charge;
+	}
+
+	return expanded;
+}
+
+void
+MemoryRepository::invalidate_expansions(const Role::Uuid& role)
+{
+	// the role and every role which includes it, directly or not
+	if (expansions.empty()) {
+		return;
+	}
+
+	std::unordered_set<Role::Uuid> visited { role };
+	std::vector<const Role::Uuid*> pending { &role };
+
+	while (!pending.empty()) {
+		const auto* current = pending.back();
+		pending.pop_back();
+
+		if (const auto it = expansions.find(*current); it != expansions.end()) {
+			cached_grants -= cache_charge(*it->second);
+			expansions.erase(it);
+		}
+
+		if (const auto it = deps.find(*current); it != deps.end()) {
+			for (const auto& parent : it->second) {
+				if (visited.insert(parent).second) {
+					pending.push_back(&parent);
+				}
+			}
+		}
+	}
 }
 
 bool
 MemoryRepository::is_valid_role(const Role::Uuid& role) const
 {
 	std::shared_lock lk{ mutex };
-	return repository.contains(role);
+	return find(role) != nullptr;
+}
+
+std::uint64_t
+MemoryRepository::version() const
+{
+	return changes.load(std::memory_order_relaxed);
+}
+
+ChurnStats
+MemoryRepository::churn() const
+{
+	return {
+		.live = live_elements.load(std::memory_order_relaxed),
+		.removed = removed_elements.load(std::memory_order_relaxed),
+	};
+}
+
+std::vector<MemoryUsage>
+MemoryRepository::memory_usage() const
+{
+	MemoryUsage roles { .structure = "roles" };
+	MemoryUsage role_names { .structure = "role_names" };
+	MemoryUsage role_uuids { .structure = "role_uuids" };
+	MemoryUsage sub_roles { .structure = "sub_roles" };
+	MemoryUsage reverse_index { .structure = "deps" };
+	MemoryUsage name_index { .structure = "name_index" };
+	MemoryUsage expansion_cache { .structure = "expansions" };
+
+	std::shared_lock lk{ mutex };
+
+	for (const auto& shard : repository) {
+		add_table(roles, *shard);
+		roles.elements += shard->size();
+
+		for (const auto& [uuid, role] : *shard) {
+			role_names.elements += 1;
+			role_names.bytes += string_bytes(role.name);
+
+			role_uuids.elements += 1;
+			role_uuids.bytes += string_bytes(uuid) + string_bytes(role.uuid);
+
+			add_table(sub_roles, role.subroles());
+			sub_roles.elements += role.subroles().size();
+			for (const auto& subrole : role.subroles()) {
+				sub_roles.bytes += string_bytes(subrole);
+			}
+		}
+	}
+
+	add_table(reverse_index, deps);
+	for (const auto& [subrole, parents] : deps) {
+		add_table(reverse_index, parents);
+		reverse_index.elements += parents.size();
+		reverse_index.bytes += string_bytes(subrole);
+		for (const auto& parent : parents) {
+			reverse_index.bytes += string_bytes(parent);
+		}
+	}
+
+	// tree nodes: the value, three links and the color
+	name_index.elements = names.size();
+	name_index.bytes = names.size() * (sizeof(decltype(names)::value_type) + 4 * sizeof(void*));
+	for (const auto& [name, uuid] : names) {
+		name_index.bytes += string_bytes(name) + string_bytes(uuid);
+	}
+
+	{
+		std::scoped_lock cache_lk{ expansions_mutex };
+		add_table(expansion_cache, expansions);
+		expansion_cache.elements = expansions.size();
+		for (const auto& [role, expanded] : expansions) {
+			expansion_cache.bytes += string_bytes(role) + sizeof(Expansion)
+				+ expanded->hashes.capacity() * sizeof(std::uint64_t)
+				+ expanded->uuids.capacity() * sizeof(Role::Uuid);
+			for (const auto& uuid : expanded->uuids) {
+				expansion_cache.bytes += string_bytes(uuid);
+			}
+		}
+	}
+
+	return { roles, role_names, role_uuids, sub_roles, reverse_index, name_index, expansion_cache };
+}
+
+void
+MemoryRepository::compact()
+{
+	// removals from here on may not be compacted by this run, so they count towards the next one
+	const auto removed = removed_elements.load(std::memory_order_relaxed);
+	std::size_t compacted_shards = 0;
+
+	// shards: rebuilt from a pinned copy without holding the lock, then swapped in
+	// a shard which a writer replaced meanwhile is left for the next run, as the copy would lose the write
+	for (std::size_t i = 0; i < shard_count; ++i) {
+		std::shared_ptr<const Shard> pinned;
+		{
+			std::shared_lock lk{ mutex };
+			pinned = repository[i];
+		}
+
+		auto compacted = std::make_shared<Shard>();
+		compacted->reserve(pinned->size());
+		for (const auto& [uuid, role] : *pinned) {
+			auto copy = role;
+			copy.compact();
+			compacted->emplace(uuid, std::move(copy));
+		}
+
+		std::scoped_lock lk{ mutex };
+		if (repository[i] == pinned) {
+			repository[i] = std::move(compacted);
+			++compacted_shards;
+		}
+	}
+
+	// the hash spreads removals evenly over the shards; those of skipped shards stay counted
+	removed_elements.fetch_sub(removed / shard_count * compacted_shards + removed % shard_count * compacted_shards / shard_count, std::memory_order_relaxed);
+
+	// reverse index: the sets in batches, so that writers wait for one batch at most; empty ones are dropped
+	std::vector<Role::Uuid> oversized;
+	{
+		std::shared_lock lk{ mutex };
+		for (const auto& [subrole, parents] : deps) {
+			if (parents.empty() || has_slack(parents)) {
+				oversized.push_back(subrole);
+			}
+		}
+	}
+
+	for (std::size_t first = 0; first < oversized.size(); first += compaction_batch_size) {
+		std::scoped_lock lk{ mutex };
+		for (auto i = first; i < std::min(first + compaction_batch_size, oversized.size()); ++i) {
+			if (const auto it = deps.find(oversized[i]); it == deps.end()) {
+				continue;
+			}
+			else if (it->second.empty()) {
+				deps.erase(it);
+			}
+			else {
+				it->second.rehash(0);
+			}
+		}
+	}
+
+	// outer tables; rehashing only relinks their nodes
+	std::scoped_lock lk{ mutex };
+	if (has_slack(deps)) {
+		deps.rehash(0);
+	}
+
+	if (has_slack(expansions)) {
+		expansions.rehash(0);
+	}
 }
\ No newline at end of file
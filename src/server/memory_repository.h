@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <shared_mutex>
 
 #include "repository.h"
@@ -10,24 +16,88 @@ namespace tser
 	class MemoryRepository : public IRepository
 	{
 	private:
+		using Shard = std::unordered_map<Role::Uuid, Role>;
+		static constexpr std::size_t shard_bits = 8;
+		static constexpr std::size_t shard_count = std::size_t{1} << shard_bits;
+
+		class Snapshot;
+
+		/// @brief Roles granted by a role, sorted by hash; stored as parallel arrays so that the hashes are scanned contiguously
+		struct Expansion
+		{
+			std::vector<std::uint64_t> hashes;
+			std::vector<Role::Uuid> uuids;
+		};
+
 		// todo: separate mutexes for each container
 		std::shared_mutex mutable mutex;
-		std::unordered_map<Role::Uuid, Role> repository;
+		// roles are split in shards which are copied on write while a snapshot holds them
+		std::array<std::shared_ptr<Shard>, shard_count> repository;
 		std::unordered_map<Role::Uuid, std::unordered_set<Role::Uuid>> deps;
+		std::set<std::pair<Role::Name, Role::Uuid>> names;
+		// bumped under the exclusive lock by every change
+		std::atomic<std::uint64_t> changes = 0;
+		// roles and inclusions; updated under the exclusive lock, read without it
+		std::atomic<std::size_t> live_elements = 0;
+		std::atomic<std::size_t> removed_elements = 0;
+
+		// filled by readers under the shared lock, hence its own mutex; writers invalidate it under the exclusive lock
+		// bounded by the granted roles it holds in total; arbitrary entries are evicted once it is full
+		std::size_t max_cached_grants;
+		std::mutex mutable expansions_mutex;
+		std::unordered_map<Role::Uuid, std::shared_ptr<const Expansion>> mutable expansions;
+		std::size_t mutable cached_grants = 0;
+
+		// helpers; expect the lock to be held
+		static std::size_t shard_index(const Role::Uuid& role);
+		const Shard& shard(const Role::Uuid& role) const;
+		Shard& mutable_shard(const Role::Uuid& role);
+		const Role* find(const Role::Uuid& role) const;
+		Role* find_mutable(const Role::Uuid& role);
+		RepositoryErr add_role_locked(Role role);
+		RepositoryErr include_role_locked(const Role::Uuid& role, const Role::Uuid& subrole);
+		void remove_dependency(const Role::Uuid& subrole, const Role::Uuid& role);
+		std::shared_ptr<const Expansion> expansion(const Role::Uuid& role) const;
+		void invalidate_expansions(const Role::Uuid& role);
 
 	public:
-		MemoryRepository() = default;
+		static constexpr std::size_t default_max_cached_grants = std::size_t{1} << 22;
+
+		/// @param max_cached_grants - bound for the granted roles held by the expansion cache, over all expansions; an empty expansion counts as one
+		explicit MemoryRepository(std::size_t max_cached_grants = default_max_cached_grants);
 
 		virtual RepositoryErr add_role(Role role) override;
 
+		virtual std::vector<RepositoryErr> add_roles(std::vector<Role> roles) override;
+
 		virtual std::unordered_map<Role::Uuid, Role> roles() const override;
 
+		virtual std::unique_ptr<IRoleSnapshot> snapshot() const override;
+
+		virtual std::vector<Role> find_by_name(std::string_view prefix, std::size_t limit) const override;
+
 		virtual RepositoryResult<std::optional<std::unordered_set<Role::Uuid>>> dependencies(const Role::Uuid& subrole) const override;
 
+		virtual RepositoryResult<std::vector<Role::Uuid>> effective_subroles(const Role::Uuid& role) const override;
+
+		virtual std::vector<RepositoryResult<std::vector<Role::Uuid>>> check_subroles(const std::vector<std::pair<Role::Uuid, std::vector<Role::Uuid>>>& queries) const override;
+
 		virtual RepositoryErr include_role(const Role::Uuid& role, const Role::Uuid& subrole) override;
 
+		virtual std::vector<RepositoryErr> include_roles(const std::vector<std::pair<Role::Uuid, Role::Uuid>>& edges) override;
+
 		virtual RepositoryErr exclude_role(const Role::Uuid& role, const Role::Uuid& subrole) override;
 
+		virtual RepositoryErr remove_role(const Role::Uuid& role, bool restrict) override;
+
 		virtual bool is_valid_role(const Role::Uuid& role) const override;
+
+		virtual std::uint64_t version() const override;
+
+		virtual ChurnStats churn() const override;
+
+		virtual std::vector<MemoryUsage> memory_usage() const override;
+
+		virtual void compact() override;
 	};
-}
\ No newline at end of file
+}
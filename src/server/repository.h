@@ -1,8 +1,13 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <expected>
+#include <memory>
 #include <optional>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "role.h"
 
@@ -17,34 +22,103 @@ namespace tser
 		ROLE_ALREADY_EXISTS,
 		ROLE_NOT_FOUND,
 		ROLE_HAS_SUBROLE,
+		ROLE_HAS_DEPENDENTS,
+		ANALYTICS_TOO_LARGE,
 	};
 
 	/// @brief Return which conveys either a value or an error
 	template <typename T>
 	using RepositoryResult = std::expected<T, RepositoryErr>;
 
+	/// @brief Consistent, point-in-time view over the roles of a Repository, read in chunks
+	/// Writers are not blocked while a snapshot is alive
+	class IRoleSnapshot
+	{
+	public:
+		/// @brief Reads the next chunk of at most max_roles roles
+		/// @return the roles of the chunk, valid until the next call or until the snapshot is destroyed; empty once all roles were read
+		virtual std::vector<const Role*> next(std::size_t max_roles) = 0;
+
+		virtual ~IRoleSnapshot() = default;
+	};
+
+	/// @brief Memory held by one of the structures of a Repository
+	struct MemoryUsage
+	{
+		std::string structure;
+		std::size_t elements = 0;
+		std::size_t bytes = 0;
+		// part of bytes which is held by unused capacity, e.g. empty hash buckets
+		std::size_t slack_bytes = 0;
+	};
+
+	/// @brief Running counts kept by a Repository; cheap to read, unlike MemoryUsage
+	struct ChurnStats
+	{
+		// roles and inclusions currently stored
+		std::size_t live = 0;
+		// roles and inclusions removed since the last compaction; what they held may remain as slack
+		std::size_t removed = 0;
+	};
+
 	/// @brief Represents a Repository with the associated operations
 	class IRepository
 	{
 	public:
 		/// @brief Attempts to add a new role to the Repository
+		/// Its included roles have to exist and must not include roles themselves, as for include_role
 		virtual RepositoryErr add_role(Role role) = 0;
 
+		/// @brief Attempts to add several roles at once; returns the result for each role, in order
+		virtual std::vector<RepositoryErr> add_roles(std::vector<Role> roles) = 0;
+
 		/// @brief Returns existing roles
 		virtual std::unordered_map<Role::Uuid, Role> roles() const = 0;
+
+		/// @brief Pins the current state of the roles, to be read without holding the Repository locked
+		virtual std::unique_ptr<IRoleSnapshot> snapshot() const = 0;
 		
+		/// @brief Returns copies of at most limit roles whose name starts with prefix, ordered by name
+		virtual std::vector<Role> find_by_name(std::string_view prefix, std::size_t limit) const = 0;
+
 		/// @brief Returns a list of roles which include a given subrole
 		virtual RepositoryResult<std::optional<std::unordered_set<Role::Uuid>>> dependencies(const Role::Uuid& subrole) const = 0;
 		
+		/// @brief Returns the roles granted by a role, directly or through inclusions
+		virtual RepositoryResult<std::vector<Role::Uuid>> effective_subroles(const Role::Uuid& role) const = 0;
+
+		/// @brief For each (role, subroles) query, returns those subroles which the role grants, directly or through inclusions
+		virtual std::vector<RepositoryResult<std::vector<Role::Uuid>>> check_subroles(const std::vector<std::pair<Role::Uuid, std::vector<Role::Uuid>>>& queries) const = 0;
+
 		/// @brief Attempts to include a subrole into a given role
 		virtual RepositoryErr include_role(const Role::Uuid& role, const Role::Uuid& subrole) = 0;
+
+		/// @brief Attempts to include several (role, subrole) pairs at once; returns the result for each pair, in order
+		virtual std::vector<RepositoryErr> include_roles(const std::vector<std::pair<Role::Uuid, Role::Uuid>>& edges) = 0;
 		
 		/// @brief Attempts to exclude a subrole from a given role
 		virtual RepositoryErr exclude_role(const Role::Uuid& role, const Role::Uuid& subrole) = 0;
 
+		/// @brief Removes a role, along with its inclusions and the inclusions of it in other roles
+		/// @param restrict - refuses to remove a role which is included in other roles
+		virtual RepositoryErr remove_role(const Role::Uuid& role, bool restrict) = 0;
+
 		/// @brief Checks if a role exists
 		virtual bool is_valid_role(const Role::Uuid& role) const = 0;
 
+		/// @brief Counter which changes whenever the roles or their inclusions may have changed
+		virtual std::uint64_t version() const = 0;
+
+		/// @brief Returns the running counts, without walking the structures
+		virtual ChurnStats churn() const = 0;
+
+		/// @brief Reports the memory held by each of the internal structures
+		virtual std::vector<MemoryUsage> memory_usage() const = 0;
+
+		/// @brief Rebuilds the internal structures to release the memory left behind by churn
+		/// Runs alongside readers and writers, which are only paused for short periods
+		virtual void compact() = 0;
+
 		virtual ~IRepository() = default;
 
 		/// @brief Provides error-to-string mapping for Repository errors
@@ -61,6 +135,8 @@ namespace tser
 			{ROLE_ALREADY_EXISTS, "role already exists"},
 			{ROLE_NOT_FOUND, "role not found"},
 			{ROLE_HAS_SUBROLE, "role has subrole"},
+			{ROLE_HAS_DEPENDENTS, "role has dependents"},
+			{ANALYTICS_TOO_LARGE, "too many granted roles for analytics"},
 		};
 	};
 }
\ No newline at end of file
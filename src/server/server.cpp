@@ -1,14 +1,65 @@
 #include <restinio/all.hpp>
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <format>
 #include <functional>
+#include <optional>
 #include <ranges>
 
+#include "analytics.h"
+#include "importer.h"
 #include "server.h"
 
 using namespace tser;
 
+namespace
+{
+	constexpr std::size_t export_chunk_size = 1024;
+	constexpr std::size_t default_name_limit = 100;
+	constexpr std::size_t max_name_limit = 1000;
+	constexpr std::size_t default_analytics_limit = 10;
+	constexpr std::size_t max_analytics_limit = 1000;
+
+	// analytics answers may lag behind writes by this much, rather than paying for a build per request
+	constexpr std::chrono::seconds analytics_max_staleness { 10 };
+
+	/// @brief Reads the limit query parameter; nullopt if it is present but not within [1, max_limit]
+	std::optional<std::size_t>
+	parse_limit(const auto& query, std::size_t default_limit, std::size_t max_limit)
+	{
+		if (!query.has("limit")) {
+			return default_limit;
+		}
+
+		const auto value = query["limit"];
+		std::size_t limit = 0;
+		const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), limit);
+		if (ec != std::errc() || end != value.data() + value.size() || limit == 0 || limit > max_limit) {
+			return std::nullopt;
+		}
+
+		return limit;
+	}
+
+	std::string
+	limit_error(std::size_t max_limit)
+	{
+		nlohmann::json j;
+		j["success"] = false;
+		j["reason"] = std::format("limit must be between 1 and {}", max_limit);
+
+		return j.dump();
+	}
+}
+
 Server::Server(std::shared_ptr<IRepository> repository)
 	: repository { repository }
+	, workers { std::max(1u, std::thread::hardware_concurrency()) }
+	, admission { workers }
+	, compactor { repository, Compactor::Config{} }
+	, analytics { repository, workers, analytics_max_staleness }
 	, router { std::make_unique<restinio::router::express_router_t<>>() }
 {
 }
@@ -24,7 +75,7 @@ Server::run(std::string address, uint16_t port)
 	};
 
 	restinio::run(
-		restinio::on_thread_pool<server_traits>(std::thread::hardware_concurrency())
+		restinio::on_thread_pool<server_traits>(workers)
 			.address(std::move(address))
 			.port(port)
 			.request_handler(std::move(router))
@@ -45,34 +96,114 @@ void
 Server::add_all_paths()
 {
 	using enum Verb;
+	using enum Priority;
 
 	add_path(
 		PUT,
 		"/v1/api/add",
+		HIGH,
 		[this](const auto&... args) {
 			return handle_add_role(args...);
 		}
 	);
 
 	add_path(
+		POST,
+		"/v1/api/import",
+		LOW,
+		[this](const auto&... args) {
+			return handle_post_import(args...);
+		},
+		1
+	);
+
+	add_admitted_path(
+		GET,
+		"/v1/api/export",
+		LOW,
+		1,
+		[this](const auto& req, const auto&, auto permit) {
+			return handle_get_export(req, std::move(permit));
+		}
+	);
+
+	// name lookups are cheap and interactive, so they do not share the budget of full listings
+	const auto listing = admission.add_route("/v1/api/roles", LOW);
+	const auto search = admission.add_route("/v1/api/roles?name_prefix", HIGH);
+	add_routed_path(
 		GET,
 		"/v1/api/roles",
-		[this](const auto&... args) {
-			return handle_get_roles(args...);
+		[=](const auto& req) {
+			return restinio::parse_query(req->header().query()).has("name_prefix") ? search : listing;
+		},
+		[this](auto req, auto par, AdmissionController::Permit) {
+			return prepare_response(req->create_response())
+				.set_body(handle_get_roles(req, par))
+				.done();
 		}
 	);
 
 	add_path(
 		GET,
 		"/v1/api/simulate/:role",
+		HIGH,
 		[this](const auto&... args) {
 			return handle_get_simulation(args...);
 		}
 	);
 
+	add_path(
+		GET,
+		"/v1/api/roles/:role/effective",
+		HIGH,
+		[this](const auto&... args) {
+			return handle_get_effective(args...);
+		}
+	);
+
+	add_path(
+		POST,
+		"/v1/api/check",
+		HIGH,
+		[this](const auto&... args) {
+			return handle_post_check(args...);
+		}
+	);
+
+	add_path(
+		GET,
+		"/v1/api/analytics/overlap/:role",
+		LOW,
+		[this](const auto&... args) {
+			return handle_get_overlap(args...);
+		},
+		1
+	);
+
+	add_path(
+		GET,
+		"/v1/api/analytics/impact",
+		LOW,
+		[this](const auto&... args) {
+			return handle_get_impact(args...);
+		},
+		1
+	);
+
+	add_path(
+		GET,
+		"/v1/api/analytics/common-parents",
+		LOW,
+		[this](const auto&... args) {
+			return handle_get_common_parents(args...);
+		},
+		1
+	);
+
 	add_path(
 		POST,
 		"/v1/api/include/:role/:subrole",
+		HIGH,
 		[this](const auto&... args) {
 			return handle_post_include(args...);
 		}
@@ -81,28 +212,93 @@ Server::add_all_paths()
 	add_path(
 		POST,
 		"/v1/api/exclude/:role/:subrole",
+		HIGH,
 		[this](const auto&... args) {
 			return handle_post_exclude(args...);
 		}
 	);
+
+	add_path(
+		DEL,
+		"/v1/api/roles/:role",
+		HIGH,
+		[this](const auto&... args) {
+			return handle_delete_role(args...);
+		}
+	);
+
+	add_path(
+		GET,
+		"/v1/api/debug/memory",
+		LOW,
+		[this](const auto&... args) {
+			return handle_get_memory(args...);
+		},
+		1
+	);
+
+	add_path(
+		POST,
+		"/v1/api/debug/compact",
+		LOW,
+		[this](const auto&... args) {
+			return handle_post_compact(args...);
+		},
+		1
+	);
+}
+
+void Server::add_path(Verb verb, std::string_view path, Priority priority, auto&& handler, std::size_t max_in_flight)
+{
+	add_admitted_path(
+		verb,
+		path,
+		priority,
+		max_in_flight,
+		[=, this](auto req, auto par, AdmissionController::Permit) {
+			return prepare_response(req->create_response())
+				.set_body(handler(req, par))
+				.done();
+		});
 }
 
-void Server::add_path(Verb verb, std::string_view path, auto&& handler)
+void Server::add_admitted_path(Verb verb, std::string_view path, Priority priority, std::size_t max_in_flight, auto&& handler)
+{
+	const auto route = admission.add_route(std::string(path), priority, max_in_flight);
+
+	add_routed_path(
+		verb,
+		path,
+		[route](const auto&) {
+			return route;
+		},
+		handler);
+}
+
+void Server::add_routed_path(Verb verb, std::string_view path, auto&& select_route, auto&& handler)
 {
 	static std::unordered_map<Verb, restinio::http_method_id_t(*)()> method_handlers {
 		{ Verb::GET,	&restinio::http_method_get },
 		{ Verb::POST,	&restinio::http_method_post },
 		{ Verb::PUT,	&restinio::http_method_put },
+		{ Verb::DEL,	&restinio::http_method_delete },
 	};
 
 	// todo: check Content-Type for handlers which expect JSON bodies
 	router->add_handler(
 		std::move(method_handlers.at(verb)()),
 		path,
-		[=](auto req, auto par) {
-			return prepare_response(req->create_response())
-				.set_body(handler(req, par))
-				.done();
+		[=, this](auto req, auto par) {
+			// shed load early instead of queueing more work behind saturated workers
+			auto permit = admission.try_admit(select_route(req));
+			if (!permit) {
+				return prepare_response(req->create_response(restinio::status_service_unavailable()))
+					.append_header(restinio::http_field::retry_after, std::to_string(admission.retry_after().count()))
+					.set_body(overload_response())
+					.done();
+			}
+
+			return handler(req, par, std::move(*permit));
 		});
 }
 
@@ -110,7 +306,7 @@ std::string
 Server::handle_add_role(const auto& req, const auto& par)
 {
 	try {
-		auto role = nlohmann::json::parse(req->body());
+		auto role = Role::parse(req->body());
 		const auto result = repository->add_role(std::move(role));
 
 		return err_to_response(result);
@@ -123,9 +319,67 @@ Server::handle_add_role(const auto& req, const auto& par)
 	}	
 }
 
+std::string
+Server::handle_post_import(const auto& req, const auto& par)
+{
+	nlohmann::json j = import_ndjson(*repository, req->body(), workers);
+	j["success"] = true;
+
+	return j.dump();
+}
+
+restinio::request_handling_status_t
+Server::handle_get_export(const auto& req, AdmissionController::Permit permit)
+{
+	// the snapshot and the route slot live until the last chunk was written
+	struct Export
+	{
+		std::unique_ptr<IRoleSnapshot> snapshot;
+		restinio::response_builder_t<restinio::chunked_output_t> response;
+		AdmissionController::Permit permit;
+
+		// one chunk in flight at a time bounds the memory, no matter how many roles there are
+		static void send_next(std::shared_ptr<Export> self)
+		{
+			auto chunk = export_ndjson(*self->snapshot, export_chunk_size);
+			if (chunk.empty()) {
+				self->response.done();
+				return;
+			}
+
+			self->response.append_chunk(std::move(chunk));
+			self->response.flush([self](const restinio::asio_ns::error_code& ec) {
+				if (!ec) {
+					send_next(self);
+				}
+			});
+		}
+	};
+
+	auto response = req->template create_response<restinio::chunked_output_t>();
+	response
+		.append_header("Server", "RESTinio server")
+		.append_header_date_field()
+		.append_header("Content-Type", "application/x-ndjson");
+
+	auto snapshot = repository->snapshot();
+
+	// from here on the time is spent on the client's download, which must not drive the class limit down
+	permit.release_class_slot();
+
+	Export::send_next(std::make_shared<Export>(std::move(snapshot), std::move(response), std::move(permit)));
+
+	return restinio::request_accepted();
+}
+
 std::string
 Server::handle_get_roles(const auto& req, const auto& par)
 {
+	const auto query = restinio::parse_query(req->header().query());
+	if (query.has("name_prefix")) {
+		return find_roles_by_name(query);
+	}
+
 	const auto roles = repository->roles();
 
 	nlohmann::json j;
@@ -142,6 +396,26 @@ Server::handle_get_roles(const auto& req, const auto& par)
 	return j.dump();
 }
 
+std::string
+Server::find_roles_by_name(const auto& query)
+{
+	const auto limit = parse_limit(query, default_name_limit, max_name_limit);
+	if (!limit) {
+		return limit_error(max_name_limit);
+	}
+
+	const auto found = repository->find_by_name(query["name_prefix"], *limit);
+
+	nlohmann::json j;
+	j["success"] = true;
+	j["roles"] = nlohmann::json::array();
+	for (const auto& role : found) {
+		j["roles"].push_back(role);
+	}
+
+	return j.dump();
+}
+
 std::string
 Server::handle_get_simulation(const auto& req, const auto& par)
 {
@@ -166,6 +440,150 @@ Server::handle_get_simulation(const auto& req, const auto& par)
 	return j.dump();
 }
 
+std::string
+Server::handle_get_effective(const auto& req, const auto& par)
+{
+	const auto roles = repository->effective_subroles(Role::Uuid(par["role"]));
+
+	nlohmann::json j;
+	if (!roles) {
+		j["success"] = false;
+		j["reason"] = repository->err_to_str(roles.error());
+	}
+	else {
+		j["success"] = true;
+		j["roles"] = roles.value();
+	}
+
+	return j.dump();
+}
+
+std::string
+Server::handle_post_check(const auto& req, const auto& par)
+{
+	// body: {"checks": [{"role": "<id>", "subroles": ["<id>", ...]}, ...]}
+	std::vector<std::pair<Role::Uuid, std::vector<Role::Uuid>>> queries;
+
+	try {
+		const auto body = nlohmann::json::parse(req->body());
+		for (const auto& check : body.at("checks")) {
+			queries.emplace_back(
+				check.at("role").get<Role::Uuid>(),
+				check.at("subroles").get<std::vector<Role::Uuid>>());
+		}
+	}
+	catch (std::exception& e) {
+		nlohmann::json j;
+		j["success"] = false;
+		j["reason"] = e.what();
+		return j.dump();
+	}
+
+	const auto results = repository->check_subroles(queries);
+
+	nlohmann::json j;
+	j["success"] = true;
+	j["results"] = nlohmann::json::array();
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		nlohmann::json result;
+		result["role"] = queries[i].first;
+
+		if (!results[i]) {
+			result["success"] = false;
+			result["reason"] = repository->err_to_str(results[i].error());
+		}
+		else {
+			result["success"] = true;
+			result["granted"] = results[i].value();
+		}
+
+		j["results"].push_back(std::move(result));
+	}
+
+	return j.dump();
+}
+
+std::string
+Server::handle_get_overlap(const auto& req, const auto& par)
+{
+	const auto limit = parse_limit(restinio::parse_query(req->header().query()), default_analytics_limit, max_analytics_limit);
+	if (!limit) {
+		return limit_error(max_analytics_limit);
+	}
+
+	const auto ranked = analytics.get().and_then([&](const auto& built) { return built->overlap(Role::Uuid(par["role"]), *limit); });
+
+	nlohmann::json j;
+	if (!ranked) {
+		j["success"] = false;
+		j["reason"] = repository->err_to_str(ranked.error());
+	}
+	else {
+		j["success"] = true;
+		j["roles"] = ranked.value();
+	}
+
+	return j.dump();
+}
+
+std::string
+Server::handle_get_impact(const auto& req, const auto& par)
+{
+	const auto limit = parse_limit(restinio::parse_query(req->header().query()), default_analytics_limit, max_analytics_limit);
+	if (!limit) {
+		return limit_error(max_analytics_limit);
+	}
+
+	const auto engine = analytics.get();
+
+	nlohmann::json j;
+	if (!engine) {
+		j["success"] = false;
+		j["reason"] = repository->err_to_str(engine.error());
+	}
+	else {
+		j["success"] = true;
+		j["roles"] = engine.value()->impact(*limit);
+	}
+
+	return j.dump();
+}
+
+std::string
+Server::handle_get_common_parents(const auto& req, const auto& par)
+{
+	// ?roles=<id>,<id>,...
+	const auto query = restinio::parse_query(req->header().query());
+
+	std::vector<Role::Uuid> roles;
+	if (query.has("roles")) {
+		for (const auto role : std::views::split(query["roles"], ',')) {
+			if (!std::ranges::empty(role)) {
+				roles.emplace_back(std::ranges::begin(role), std::ranges::end(role));
+			}
+		}
+	}
+
+	nlohmann::json j;
+	if (roles.empty()) {
+		j["success"] = false;
+		j["reason"] = "roles must list at least one role";
+		return j.dump();
+	}
+
+	const auto parents = analytics.get().and_then([&](const auto& built) { return built->common_parents(roles); });
+	if (!parents) {
+		j["success"] = false;
+		j["reason"] = repository->err_to_str(parents.error());
+	}
+	else {
+		j["success"] = true;
+		j["roles"] = parents.value();
+	}
+
+	return j.dump();
+}
+
 std::string
 Server::handle_post_include(const auto& req, const auto& par)
 {
@@ -183,9 +601,67 @@ Server::handle_post_exclude(const auto& req, const auto& par)
 		Role::Uuid(par["role"]),
 		Role::Uuid(par["subrole"]));
 
+	if (result == RepositoryErr::OK) {
+		compact_if_churned();
+	}
+
+	return err_to_response(result);
+}
+
+std::string
+Server::handle_delete_role(const auto& req, const auto& par)
+{
+	// ?restrict=true refuses to remove a role which is still included in other roles
+	const auto query = restinio::parse_query(req->header().query());
+	const auto restrict = query.has("restrict") && query["restrict"] == "true";
+
+	const auto result = repository->remove_role(Role::Uuid(par["role"]), restrict);
+
+	if (result == RepositoryErr::OK) {
+		compact_if_churned();
+	}
+
 	return err_to_response(result);
 }
 
+std::string
+Server::handle_get_memory(const auto& req, const auto& par)
+{
+	const auto churn = repository->churn();
+
+	nlohmann::json j;
+	j["success"] = true;
+	j["approximate"] = true;
+	j["structures"] = repository->memory_usage();
+	j["live_elements"] = churn.live;
+	j["removed_elements"] = churn.removed;
+	j["compaction_advised"] = compactor.should_compact(churn);
+
+	return j.dump();
+}
+
+std::string
+Server::handle_post_compact(const auto& req, const auto& par)
+{
+	const auto [before, after] = compactor.compact_now();
+
+	nlohmann::json j;
+	j["success"] = true;
+	j["before"] = before;
+	j["after"] = after;
+
+	return j.dump();
+}
+
+void
+Server::compact_if_churned()
+{
+	// the counters are cheap to read; the compaction itself runs on the compactor thread
+	if (compactor.should_compact(repository->churn())) {
+		compactor.trigger();
+	}
+}
+
 std::string Server::err_to_response(RepositoryErr e)
 {
 	nlohmann::json j;
@@ -199,3 +675,13 @@ std::string Server::err_to_response(RepositoryErr e)
 
 	return j.dump();
 }
+
+std::string
+Server::overload_response()
+{
+	nlohmann::json j;
+	j["success"] = false;
+	j["reason"] = "server overloaded";
+
+	return j.dump();
+}
@@ -8,6 +8,9 @@
 #include <restinio/router/express.hpp>
 
 // proj
+#include "admission.h"
+#include "analytics.h"
+#include "compactor.h"
 #include "repository.h"
 
 namespace tser
@@ -32,22 +35,42 @@ namespace tser
 			GET,
 			POST,
 			PUT,
+			DEL,
 		};
 
 		void add_all_paths();
-		void add_path(Verb verb, std::string_view path, auto&& handler);
+		void add_path(Verb verb, std::string_view path, Priority priority, auto&& handler, std::size_t max_in_flight = 0);
+		void add_admitted_path(Verb verb, std::string_view path, Priority priority, std::size_t max_in_flight, auto&& handler);
+		void add_routed_path(Verb verb, std::string_view path, auto&& select_route, auto&& handler);
+		void compact_if_churned();
 
 		// handlers
 		auto prepare_response(auto&& response);
 		std::string handle_add_role(const auto& req, const auto& par);
+		std::string handle_post_import(const auto& req, const auto& par);
+		restinio::request_handling_status_t handle_get_export(const auto& req, AdmissionController::Permit permit);
 		std::string handle_get_roles(const auto& req, const auto& par);
+		std::string find_roles_by_name(const auto& query);
 		std::string handle_get_simulation(const auto& req, const auto& par);
+		std::string handle_get_effective(const auto& req, const auto& par);
+		std::string handle_post_check(const auto& req, const auto& par);
+		std::string handle_get_overlap(const auto& req, const auto& par);
+		std::string handle_get_impact(const auto& req, const auto& par);
+		std::string handle_get_common_parents(const auto& req, const auto& par);
 		std::string handle_post_include(const auto& req, const auto& par);
 		std::string handle_post_exclude(const auto& req, const auto& par);
+		std::string handle_delete_role(const auto& req, const auto& par);
+		std::string handle_get_memory(const auto& req, const auto& par);
+		std::string handle_post_compact(const auto& req, const auto& par);
 		std::string err_to_response(RepositoryErr e);
+		std::string overload_response();
 
 		// data members
 		std::shared_ptr<IRepository> repository;
+		std::size_t workers;
+		AdmissionController admission;
+		Compactor compactor;
+		AnalyticsCache analytics;
 		std::unique_ptr<restinio::router::express_router_t<>> router;
 	};
 }
\ No newline at end of file
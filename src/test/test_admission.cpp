@@ -0,0 +1,73 @@
+#include "pch.h"
+
+#include "..\server\admission.h"
+#include "..\server\admission.cpp"
+
+namespace tser_test {
+	using namespace tser;
+	using namespace std::chrono_literals;
+
+	TEST(AdaptiveLimiter, ShedsWhenFull) {
+		auto limiter = AdaptiveLimiter({ .min_limit = 1, .max_limit = 2, .initial_limit = 2, .max_queued = 0 });
+
+		ASSERT_TRUE(limiter.acquire());
+		ASSERT_TRUE(limiter.acquire());
+		ASSERT_FALSE(limiter.acquire()) << "should shed when the limit is reached and the queue is disabled";
+
+		limiter.release(0ns);
+		ASSERT_TRUE(limiter.acquire()) << "should admit once a slot is released";
+	}
+
+	TEST(AdaptiveLimiter, WaitingCountsAgainstThreads) {
+		auto limiter = AdaptiveLimiter({ .min_limit = 1, .max_limit = 1, .initial_limit = 1, .max_queued = 4, .max_threads = 1, .max_wait = 10s });
+
+		ASSERT_TRUE(limiter.acquire());
+
+		const auto start = std::chrono::steady_clock::now();
+		ASSERT_FALSE(limiter.acquire()) << "should shed instead of blocking a thread beyond max_threads";
+		ASSERT_LT(std::chrono::steady_clock::now() - start, 1s);
+	}
+
+	TEST(AdaptiveLimiter, AdaptsToLatency) {
+		auto limiter = AdaptiveLimiter({ .min_limit = 1, .max_limit = 8, .initial_limit = 4, .target_latency = 10ms, .backoff = 0.5 });
+
+		limiter.acquire();
+		limiter.release(100ms);
+		ASSERT_EQ(limiter.limit(), 2u) << "should decrease multiplicatively on slow requests";
+
+		for (int i = 0; i < 16; ++i) {
+			limiter.acquire();
+			limiter.release(1ms);
+		}
+		ASSERT_GT(limiter.limit(), 2u) << "should increase additively on fast requests";
+		ASSERT_LE(limiter.limit(), 8u);
+	}
+
+	TEST(AdmissionController, RouteLimit) {
+		auto admission = AdmissionController(8);
+		const auto bulk = admission.add_route("/bulk", Priority::LOW, 1);
+		const auto other = admission.add_route("/other", Priority::HIGH);
+
+		auto permit = admission.try_admit(bulk);
+		ASSERT_TRUE(permit.has_value());
+		ASSERT_FALSE(admission.try_admit(bulk).has_value()) << "should respect the per-route limit";
+		ASSERT_TRUE(admission.try_admit(other).has_value()) << "should not affect other routes";
+
+		permit.reset();
+		ASSERT_TRUE(admission.try_admit(bulk).has_value());
+	}
+
+	TEST(AdmissionController, ReleaseClassSlot) {
+		auto admission = AdmissionController(2);
+		const auto stream = admission.add_route("/stream", Priority::LOW, 1);
+		const auto listing = admission.add_route("/listing", Priority::LOW);
+
+		// the low class has a single slot with two workers
+		auto permit = admission.try_admit(stream);
+		ASSERT_FALSE(admission.try_admit(listing).has_value());
+
+		permit->release_class_slot();
+		ASSERT_TRUE(admission.try_admit(listing).has_value()) << "should free the class slot";
+		ASSERT_FALSE(admission.try_admit(stream).has_value()) << "should keep the route slot";
+	}
+}
@@ -0,0 +1,167 @@
+#include "pch.h"
+
+// role.cpp and memory_repository.cpp are compiled in through test_memory_repository.cpp
+#include "..\server\memory_repository.h"
+#include "..\server\analytics.h"
+#include "..\server\analytics.cpp"
+
+namespace tser_test {
+	using namespace tser;
+
+	/// 000 grants 010, 011, 012; 001 grants 010, 011; 002 grants 011 and, through 003, 012
+	void fill(MemoryRepository& repo) {
+		for (const auto* uuid : { "000", "001", "002", "003", "010", "011", "012" }) {
+			repo.add_role(Role("role", uuid));
+		}
+
+		repo.include_roles({
+			{ "000", "010" }, { "000", "011" }, { "000", "012" },
+			{ "001", "010" }, { "001", "011" },
+			{ "002", "011" }, { "002", "003" },
+			{ "003", "012" },
+		});
+	}
+
+	TEST(Analytics, Overlap) {
+		MemoryRepository repo;
+		fill(repo);
+
+		const auto analytics = Analytics::build(repo, 4).value();
+
+		const auto ranked = analytics.overlap("000", 10);
+		ASSERT_TRUE(ranked.has_value());
+		ASSERT_EQ(ranked.value().size(), 3);
+		ASSERT_EQ(ranked.value()[0].uuid, "001");
+		ASSERT_EQ(ranked.value()[0].count, 2);
+		ASSERT_EQ(ranked.value()[1].uuid, "002");
+		ASSERT_EQ(ranked.value()[1].count, 2) << "should count roles granted through inclusions";
+		ASSERT_EQ(ranked.value()[2].uuid, "003");
+
+		ASSERT_EQ(analytics.overlap("000", 1).value().size(), 1);
+		ASSERT_TRUE(analytics.overlap("010", 10).value().empty());
+		ASSERT_EQ(analytics.overlap("404", 10).error(), RepositoryErr::ROLE_NOT_FOUND);
+	}
+
+	TEST(Analytics, Impact) {
+		MemoryRepository repo;
+		fill(repo);
+
+		const auto ranked = Analytics::build(repo, 4).value().impact(2);
+
+		ASSERT_EQ(ranked.size(), 2);
+		ASSERT_EQ(ranked[0].uuid, "011");
+		ASSERT_EQ(ranked[0].count, 3);
+		ASSERT_EQ(ranked[1].uuid, "012");
+		ASSERT_EQ(ranked[1].count, 3);
+	}
+
+	TEST(Analytics, CommonParents) {
+		MemoryRepository repo;
+		fill(repo);
+
+		const auto analytics = Analytics::build(repo, 4).value();
+
+		auto parents = analytics.common_parents({ "011", "012" }).value();
+		std::ranges::sort(parents);
+		ASSERT_EQ(parents, (std::vector<Role::Uuid>{ "000", "002" }));
+
+		ASSERT_TRUE(analytics.common_parents({ "000" }).value().empty());
+		ASSERT_EQ(analytics.common_parents({ "010", "404" }).error(), RepositoryErr::ROLE_NOT_FOUND);
+		ASSERT_EQ(analytics.common_parents({ "000", "404" }).error(), RepositoryErr::ROLE_NOT_FOUND) << "should check every role";
+	}
+
+	TEST(Analytics, TooLarge) {
+		MemoryRepository repo;
+		fill(repo);
+
+		// 4 granting rows by 4 granted columns, one word per row either way
+		ASSERT_EQ(Analytics::build(repo, 4, 4 * 64).value().role_count(), 7);
+		ASSERT_EQ(Analytics::build(repo, 4, 3 * 64).error(), RepositoryErr::ANALYTICS_TOO_LARGE);
+	}
+
+	TEST(AnalyticsCache, RebuildsOnChange) {
+		using namespace std::chrono_literals;
+
+		auto repo = std::make_shared<MemoryRepository>();
+		fill(*repo);
+
+		auto cache = AnalyticsCache(repo, 4, 0ms);
+		const auto first = cache.get().value();
+		ASSERT_EQ(cache.get().value(), first) << "should reuse the engine while nothing changed";
+
+		repo->add_role(Role("role", "004"));
+		const auto second = cache.get().value();
+		ASSERT_NE(second, first) << "should rebuild after a change";
+		ASSERT_EQ(second->role_count(), 8);
+
+		auto lagging = AnalyticsCache(repo, 4, 1h);
+		const auto built = lagging.get().value();
+		repo->add_role(Role("role", "005"));
+		ASSERT_EQ(lagging.get().value(), built) << "should serve the previous engine within max_staleness";
+	}
+
+	TEST(AnalyticsCache, KeepsBuildError) {
+		using namespace std::chrono_literals;
+
+		auto repo = std::make_shared<MemoryRepository>();
+		fill(*repo);
+
+		auto cache = AnalyticsCache(repo, 4, 1h);
+		ASSERT_TRUE(cache.get().has_value());
+
+		// grow past the default bound of the matrices
+		constexpr int granting = 70'000;
+		std::vector<Role> roles;
+		for (int i = 0; i < 2 * granting; ++i) {
+			roles.emplace_back("role", "r" + std::to_string(i));
+		}
+		repo->add_roles(std::move(roles));
+
+		std::vector<std::pair<Role::Uuid, Role::Uuid>> edges;
+		for (int i = 0; i < granting; ++i) {
+			edges.emplace_back("r" + std::to_string(i), "r" + std::to_string(granting + i));
+		}
+		repo->include_roles(edges);
+
+		ASSERT_TRUE(cache.get().has_value()) << "should serve the previous engine within max_staleness";
+
+		auto strict = AnalyticsCache(repo, 4, 0ms);
+		ASSERT_EQ(strict.get().error(), RepositoryErr::ANALYTICS_TOO_LARGE);
+	}
+
+	TEST(Analytics, Large) {
+		MemoryRepository repo;
+
+		std::vector<Role> roles;
+		for (int i = 0; i < 3000; ++i) {
+			roles.emplace_back("role", std::to_string(i));
+		}
+		repo.add_roles(std::move(roles));
+
+		// roles [0, 1000) include the leaves [1000, 3000) whose index is a multiple of theirs
+		std::vector<std::pair<Role::Uuid, Role::Uuid>> edges;
+		for (int parent = 1; parent < 1000; ++parent) {
+			for (int leaf = 1000; leaf < 3000; ++leaf) {
+				if (leaf % parent == 0) {
+					edges.emplace_back(std::to_string(parent), std::to_string(leaf));
+				}
+			}
+		}
+		repo.include_roles(edges);
+
+		const auto analytics = Analytics::build(repo, 8).value();
+		ASSERT_EQ(analytics.role_count(), 3000);
+
+		const auto impact = analytics.impact(10);
+		ASSERT_EQ(impact.size(), 10);
+		ASSERT_TRUE(std::ranges::is_sorted(impact, std::ranges::greater{}, &Analytics::Ranked::count));
+
+		auto parents = analytics.common_parents({ "1024", "2048" }).value();
+		std::ranges::sort(parents, {}, [](const auto& uuid) { return std::stoi(uuid); });
+		ASSERT_EQ(parents, (std::vector<Role::Uuid>{ "1", "2", "4", "8", "16", "32", "64", "128", "256", "512" }));
+
+		const auto overlap = analytics.overlap("500", 1).value();
+		ASSERT_EQ(overlap.front().uuid, "1") << "ties should be ordered by uuid";
+		ASSERT_EQ(overlap.front().count, 4);
+	}
+}
@@ -0,0 +1,48 @@
+#include "pch.h"
+
+// role.cpp and memory_repository.cpp are compiled in through test_memory_repository.cpp
+#include "..\server\memory_repository.h"
+#include "..\server\compactor.h"
+#include "..\server\compactor.cpp"
+
+namespace tser_test {
+	using namespace tser;
+
+	TEST(Compactor, ShouldCompact) {
+		const auto compactor = Compactor(std::make_shared<MemoryRepository>(), Compactor::Config {
+			.removed_ratio = 0.5,
+			.min_removed = 100,
+		});
+
+		ASSERT_FALSE(compactor.should_compact({}));
+		ASSERT_FALSE(compactor.should_compact({ .live = 1000, .removed = 400 }));
+		ASSERT_FALSE(compactor.should_compact({ .live = 150, .removed = 99 })) << "too little removed to be worth it";
+		ASSERT_TRUE(compactor.should_compact({ .live = 1000, .removed = 600 }));
+	}
+
+	TEST(Compactor, CompactNow) {
+		auto repo = std::make_shared<MemoryRepository>();
+		for (int i = 0; i < 1000; ++i) {
+			repo->add_role(Role("role", std::to_string(i)));
+			repo->include_role("0", std::to_string(i));
+		}
+		for (int i = 2; i < 1000; ++i) {
+			repo->exclude_role("0", std::to_string(i));
+		}
+
+		ASSERT_GT(repo->churn().removed, 0);
+
+		auto compactor = Compactor(repo, {});
+		const auto [before, after] = compactor.compact_now();
+
+		const auto sub_roles = [](const std::vector<MemoryUsage>& usage) {
+			return std::ranges::find(usage, "sub_roles", &MemoryUsage::structure)->bytes;
+		};
+
+		ASSERT_EQ(before.size(), after.size());
+		ASSERT_LT(sub_roles(after), sub_roles(before)) << "should shrink the subroles of role 0";
+		ASSERT_EQ(repo->churn().removed, 0) << "should count the compacted removals as reclaimed";
+		ASSERT_TRUE(repo->is_valid_role("999"));
+		ASSERT_EQ(repo->effective_subroles("0").value(), (std::vector<Role::Uuid>{ "1" }));
+	}
+}
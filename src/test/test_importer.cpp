@@ -0,0 +1,112 @@
+#include "pch.h"
+
+// role.cpp and memory_repository.cpp are compiled in through test_memory_repository.cpp
+#include "..\server\memory_repository.h"
+#include "..\server\importer.h"
+#include "..\server\importer.cpp"
+
+namespace tser_test {
+	using namespace tser;
+
+	TEST(Importer, ImportNdjson) {
+		auto repo = MemoryRepository();
+		repo.add_role(Role("existing", "999"));
+
+		const auto body =
+			R"({"name": "role_0", "id": "000", "includedRoles": ["001", "002"]})" "\n"
+			R"({"name": "role_1", "id": "001"})" "\r\n"
+			"\n"
+			R"({"name": "role_2", "id": "002"})" "\n"
+			R"({"name": "broken", "id": )" "\n"
+			R"({"name": "again", "id": "999"})" "\n"
+			R"({"name": "role_3", "id": "003", "includedRoles": ["404"]})";
+
+		const auto summary = import_ndjson(repo, body, 4);
+
+		ASSERT_EQ(summary.accepted, 4);
+		ASSERT_EQ(summary.rejected, 2);
+		ASSERT_EQ(summary.edges_accepted, 2);
+		ASSERT_EQ(summary.edges_rejected, 1);
+
+		ASSERT_EQ(summary.errors.size(), 3);
+		ASSERT_EQ(summary.errors[0].line, 5);
+		ASSERT_EQ(summary.errors[1].line, 6);
+		ASSERT_EQ(summary.errors[2].line, 7);
+
+		const auto stored = repo.roles();
+		ASSERT_TRUE(stored.at("000").has_subrole("001"));
+		ASSERT_TRUE(stored.at("000").has_subrole("002"));
+		ASSERT_FALSE(stored.at("003").has_subroles());
+		ASSERT_EQ(stored.at("999").name, "existing");
+	}
+
+	TEST(Importer, ImportNestedInclusions) {
+		auto repo = MemoryRepository();
+
+		// every role is listed before the role which includes it, so line order would reject the inner inclusions
+		const auto body =
+			R"({"name": "c", "id": "c", "includedRoles": ["d"]})" "\n"
+			R"({"name": "b", "id": "b", "includedRoles": ["c", "e"]})" "\n"
+			R"({"name": "a", "id": "a", "includedRoles": ["b"]})" "\n"
+			R"({"name": "d", "id": "d"})" "\n"
+			R"({"name": "e", "id": "e"})" "\n";
+
+		const auto summary = import_ndjson(repo, body, 4);
+
+		ASSERT_EQ(summary.accepted, 5);
+		ASSERT_EQ(summary.edges_accepted, 4);
+		ASSERT_EQ(summary.edges_rejected, 0);
+
+		const auto stored = repo.roles();
+		ASSERT_TRUE(stored.at("a").has_subrole("b"));
+		ASSERT_TRUE(stored.at("b").has_subrole("c"));
+		ASSERT_TRUE(stored.at("b").has_subrole("e"));
+		ASSERT_TRUE(stored.at("c").has_subrole("d"));
+	}
+
+	TEST(Importer, RoundTrip) {
+		auto repo = MemoryRepository();
+		for (int i = 0; i < 1000; ++i) {
+			repo.add_role(Role("role", std::to_string(i)));
+		}
+
+		// two levels, built top down the way the API allows
+		for (int i = 0; i < 100; ++i) {
+			repo.include_role(std::to_string(i), std::to_string(100 + i));
+		}
+		for (int i = 100; i < 200; ++i) {
+			repo.include_role(std::to_string(i), std::to_string(200 + i));
+			repo.include_role(std::to_string(i), std::to_string(600 + i));
+		}
+
+		// exported in shard order, which says nothing about the order of the inclusions
+		std::string body;
+		const auto snapshot = repo.snapshot();
+		for (auto chunk = export_ndjson(*snapshot, 64); !chunk.empty(); chunk = export_ndjson(*snapshot, 64)) {
+			body += chunk;
+		}
+
+		auto imported = MemoryRepository();
+		const auto summary = import_ndjson(imported, body, 4);
+
+		ASSERT_EQ(summary.accepted, 1000);
+		ASSERT_EQ(summary.edges_accepted, 300);
+		ASSERT_EQ(summary.edges_rejected, 0);
+		ASSERT_EQ(imported.roles(), repo.roles());
+	}
+
+	TEST(Importer, ImportParallel) {
+		auto repo = MemoryRepository();
+
+		std::string body;
+		for (int i = 0; i < 10000; ++i) {
+			body += nlohmann::json(Role("role", std::to_string(i))).dump() + "\n";
+		}
+
+		const auto summary = import_ndjson(repo, body, 8);
+
+		ASSERT_EQ(summary.accepted, 10000);
+		ASSERT_EQ(summary.rejected, 0);
+		ASSERT_EQ(repo.roles().size(), 10000);
+	}
+}
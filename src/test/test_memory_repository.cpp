@@ -1,5 +1,8 @@
 #include "pch.h"
 
+#include <random>
+#include <thread>
+
 #include "..\common\role.h"
 #include "..\common\role.cpp"
 #include "..\server\memory_repository.h"
@@ -114,4 +117,436 @@ namespace tser_test {
 		stored = repo.roles();
 		ASSERT_FALSE(stored[roles[0].uuid].has_subrole(roles[1].uuid)) << "should not contain sub-role";
 	}
+
+	TEST(MemoryRepository, AddRoles) {
+		auto repo = MemoryRepository();
+		repo.add_role(Role("role_0", "000"));
+
+		const auto results = repo.add_roles({
+			Role("role_0", "000"),
+			Role("role_1", "001"),
+			Role("role_2", "001"),
+		});
+
+		ASSERT_EQ(results.size(), 3);
+		ASSERT_EQ(results[0], RepositoryErr::ROLE_ALREADY_EXISTS);
+		ASSERT_EQ(results[1], RepositoryErr::OK);
+		ASSERT_EQ(results[2], RepositoryErr::ROLE_ALREADY_EXISTS);
+		ASSERT_EQ(repo.roles().at("001").name, "role_1");
+	}
+
+	TEST(MemoryRepository, IncludeRoles) {
+		auto repo = MemoryRepository();
+
+		Role roles[] = {
+			Role("role_0", "000"),
+			Role("role_1", "001"),
+			Role("role_2", "002"),
+		};
+
+		for (const auto& role : roles) {
+			repo.add_role(role);
+		}
+
+		const auto results = repo.include_roles({
+			{ "000", "001" },
+			{ "000", "001" },
+			{ "000", "000" },
+			{ "000", "404" },
+			{ "002", "000" },
+			{ "002", "001" },
+		});
+
+		const RepositoryErr expected[] = {
+			RepositoryErr::OK,
+			RepositoryErr::UNKNOWN_ERR,
+			RepositoryErr::ILLEGAL_OP,
+			RepositoryErr::ROLE_NOT_FOUND,
+			RepositoryErr::ROLE_HAS_SUBROLE,
+			RepositoryErr::OK,
+		};
+
+		ASSERT_TRUE(std::ranges::equal(results, expected));
+
+		const auto deps = repo.dependencies("001");
+		ASSERT_TRUE(deps.has_value() && deps.value().has_value());
+		ASSERT_EQ(deps.value().value(), (std::unordered_set<Role::Uuid>{ "000", "002" }));
+	}
+
+	TEST(MemoryRepository, Snapshot) {
+		auto repo = MemoryRepository();
+
+		for (int i = 0; i < 1000; ++i) {
+			repo.add_role(Role("role", std::to_string(i)));
+		}
+
+		auto snapshot = repo.snapshot();
+
+		repo.add_role(Role("role", "1000"));
+		repo.include_role("0", "1");
+		ASSERT_TRUE(repo.roles().at("0").has_subrole("1"));
+
+		std::unordered_map<Role::Uuid, Role> seen;
+		for (auto chunk = snapshot->next(64); !chunk.empty(); chunk = snapshot->next(64)) {
+			ASSERT_LE(chunk.size(), 64);
+			for (const auto* role : chunk) {
+				seen.insert({ role->uuid, *role });
+			}
+		}
+
+		ASSERT_EQ(seen.size(), 1000) << "should not see roles added after the snapshot";
+		ASSERT_FALSE(seen.at("0").has_subroles()) << "should not see changes made after the snapshot";
+	}
+
+	TEST(MemoryRepository, ExcludeRoleReclaimsDependencies) {
+		auto repo = MemoryRepository();
+		repo.add_role(Role("role_0", "000"));
+		repo.add_role(Role("role_1", "001"));
+
+		repo.include_role("000", "001");
+		repo.exclude_role("000", "001");
+
+		auto deps = repo.dependencies("001");
+		ASSERT_TRUE(deps.has_value());
+		ASSERT_FALSE(deps.value().has_value()) << "should not keep an empty entry";
+	}
+
+	TEST(MemoryRepository, AddRoleWithSubroles) {
+		auto repo = MemoryRepository();
+
+		repo.add_role(Role("role_0", "000"));
+		repo.add_role(Role("role_1", "001"));
+
+		auto role = Role("role_2", "002");
+		role.add_subrole("000");
+		ASSERT_EQ(repo.add_role(role), RepositoryErr::OK);
+		ASSERT_EQ(repo.dependencies("000").value().value(), (std::unordered_set<Role::Uuid>{ "002" }));
+
+		ASSERT_EQ(repo.remove_role("000", true), RepositoryErr::ROLE_HAS_DEPENDENTS);
+		ASSERT_EQ(repo.churn().live, 4);
+		ASSERT_EQ(repo.remove_role("000", false), RepositoryErr::OK);
+		ASSERT_FALSE(repo.roles().at("002").has_subroles());
+		ASSERT_EQ(repo.churn().live, 2) << "should count the role and its inclusion as removed";
+		ASSERT_EQ(repo.churn().removed, 2);
+
+		auto dangling = Role("role_3", "003");
+		dangling.add_subrole("404");
+		ASSERT_EQ(repo.add_role(dangling), RepositoryErr::ROLE_NOT_FOUND);
+
+		auto nested = Role("role_3", "003");
+		nested.add_subrole("002");
+		repo.include_role("002", "001");
+		ASSERT_EQ(repo.add_role(nested), RepositoryErr::ROLE_HAS_SUBROLE);
+
+		auto own = Role("role_3", "003");
+		own.add_subrole("003");
+		ASSERT_EQ(repo.add_roles({ own, dangling }), (std::vector<RepositoryErr>{ RepositoryErr::ILLEGAL_OP, RepositoryErr::ROLE_NOT_FOUND }));
+		ASSERT_FALSE(repo.is_valid_role("003"));
+	}
+
+	TEST(MemoryRepository, RemoveRole) {
+		auto repo = MemoryRepository();
+
+		Role roles[] = {
+			Role("role_0", "000"),
+			Role("role_1", "001"),
+			Role("role_2", "002"),
+		};
+
+		for (const auto& role : roles) {
+			repo.add_role(role);
+		}
+
+		repo.include_role("000", "001");
+		repo.include_role("001", "002");
+
+		ASSERT_EQ(repo.remove_role("001", true), RepositoryErr::ROLE_HAS_DEPENDENTS);
+		ASSERT_TRUE(repo.is_valid_role("001"));
+
+		ASSERT_EQ(repo.remove_role("001", false), RepositoryErr::OK);
+		ASSERT_FALSE(repo.is_valid_role("001"));
+		ASSERT_EQ(repo.remove_role("001", false), RepositoryErr::ROLE_NOT_FOUND);
+
+		const auto stored = repo.roles();
+		ASSERT_FALSE(stored.at("000").has_subroles()) << "should drop the inclusion of the removed role";
+
+		auto deps = repo.dependencies("002");
+		ASSERT_TRUE(deps.has_value());
+		ASSERT_FALSE(deps.value().has_value()) << "should drop the inclusions of the removed role";
+
+		ASSERT_EQ(repo.remove_role("002", true), RepositoryErr::OK);
+	}
+
+	TEST(MemoryRepository, FindByName) {
+		auto repo = MemoryRepository();
+
+		Role roles[] = {
+			Role("admin", "000"),
+			Role("admin_read", "001"),
+			Role("admin_write", "002"),
+			Role("auditor", "003"),
+			Role("admin", "004"),
+		};
+
+		for (const auto& role : roles) {
+			repo.add_role(role);
+		}
+
+		auto found = repo.find_by_name("admin_", 10);
+		ASSERT_EQ(found.size(), 2);
+		ASSERT_EQ(found[0].uuid, "001");
+		ASSERT_EQ(found[1].uuid, "002");
+
+		found = repo.find_by_name("adm", 3);
+		ASSERT_EQ(found.size(), 3) << "should respect the limit";
+		ASSERT_EQ(found[0].name, "admin");
+		ASSERT_EQ(found[1].name, "admin");
+
+		ASSERT_EQ(repo.find_by_name("", 10).size(), 5);
+		ASSERT_TRUE(repo.find_by_name("b", 10).empty());
+
+		repo.remove_role("001", false);
+		ASSERT_EQ(repo.find_by_name("admin_", 10).size(), 1);
+	}
+
+	TEST(MemoryRepository, EffectiveSubroles) {
+		auto repo = MemoryRepository();
+
+		for (const auto* uuid : { "000", "001", "002", "003", "004" }) {
+			repo.add_role(Role("role", uuid));
+		}
+
+		// 002 has no subroles yet when included; 003 is added to it afterwards
+		repo.include_roles({ { "000", "001" }, { "000", "002" }, { "002", "003" } });
+
+		auto effective = repo.effective_subroles("000");
+		ASSERT_TRUE(effective.has_value());
+		std::ranges::sort(effective.value());
+		ASSERT_EQ(effective.value(), (std::vector<Role::Uuid>{ "001", "002", "003" }));
+
+		ASSERT_EQ(repo.effective_subroles("404").error(), RepositoryErr::ROLE_NOT_FOUND);
+
+		// cached expansions follow the mutations, including those on included roles
+		repo.include_role("002", "004");
+		ASSERT_EQ(repo.effective_subroles("000").value().size(), 4);
+
+		repo.exclude_role("000", "002");
+		ASSERT_EQ(repo.effective_subroles("000").value(), (std::vector<Role::Uuid>{ "001" }));
+
+		repo.remove_role("001", false);
+		ASSERT_TRUE(repo.effective_subroles("000").value().empty());
+	}
+
+	TEST(MemoryRepository, CheckSubroles) {
+		auto repo = MemoryRepository();
+
+		for (const auto* uuid : { "000", "001", "002", "003" }) {
+			repo.add_role(Role("role", uuid));
+		}
+
+		repo.include_roles({ { "000", "001" }, { "000", "002" } });
+
+		const auto results = repo.check_subroles({
+			{ "000", { "003", "002", "404" } },
+			{ "000", { "003" } },
+			{ "001", {} },
+			{ "404", { "001" } },
+		});
+
+		ASSERT_EQ(results.size(), 4);
+		ASSERT_EQ(results[0].value(), (std::vector<Role::Uuid>{ "002" }));
+		ASSERT_TRUE(results[1].value().empty());
+		ASSERT_TRUE(results[2].value().empty());
+		ASSERT_EQ(results[3].error(), RepositoryErr::ROLE_NOT_FOUND);
+	}
+
+	TEST(MemoryRepository, CheckSubrolesLarge) {
+		auto repo = MemoryRepository();
+
+		repo.add_role(Role("role", "root"));
+		for (int i = 0; i < 2000; ++i) {
+			repo.add_role(Role("role", std::to_string(i)));
+			if (i % 2 == 0) {
+				repo.include_role("root", std::to_string(i));
+			}
+		}
+
+		std::vector<Role::Uuid> queried;
+		std::vector<Role::Uuid> expected;
+		for (int i = 0; i < 2000; i += 7) {
+			queried.push_back(std::to_string(i));
+			if (i % 2 == 0) {
+				expected.push_back(std::to_string(i));
+			}
+		}
+		queried.push_back("missing");
+
+		auto granted = repo.check_subroles({ { "root", queried } })[0].value();
+		std::ranges::sort(granted);
+		std::ranges::sort(expected);
+		ASSERT_EQ(granted, expected);
+	}
+
+	TEST(MemoryRepository, ExpansionCacheIsBounded) {
+		auto repo = MemoryRepository(4);
+
+		for (const auto* uuid : { "000", "001", "002", "003", "010", "011", "012", "020" }) {
+			repo.add_role(Role("role", uuid));
+		}
+		repo.include_roles({ { "000", "001" }, { "000", "002" }, { "000", "003" }, { "010", "011" }, { "010", "012" } });
+		for (const auto* uuid : { "001", "002", "003", "011", "012" }) {
+			repo.include_role("020", uuid);
+		}
+
+		const auto cached = [&] {
+			const auto usage = repo.memory_usage();
+			return std::ranges::find(usage, "expansions", &MemoryUsage::structure)->elements;
+		};
+
+		ASSERT_EQ(repo.effective_subroles("000").value().size(), 3);
+		ASSERT_EQ(cached(), 1);
+
+		ASSERT_EQ(repo.effective_subroles("010").value().size(), 2);
+		ASSERT_EQ(cached(), 1) << "should evict once the granted roles exceed the bound";
+
+		ASSERT_EQ(repo.effective_subroles("020").value().size(), 5);
+		ASSERT_EQ(cached(), 1) << "should not cache an expansion larger than the bound";
+
+		ASSERT_EQ(repo.effective_subroles("000").value().size(), 3);
+	}
+
+	TEST(MemoryRepository, ExpansionCacheEvictsLeafRoles) {
+		auto repo = MemoryRepository(4);
+
+		for (int i = 0; i < 16; ++i) {
+			repo.add_role(Role("role", std::to_string(i)));
+		}
+
+		for (int i = 0; i < 16; ++i) {
+			ASSERT_TRUE(repo.effective_subroles(std::to_string(i)).value().empty());
+		}
+
+		const auto usage = repo.memory_usage();
+		ASSERT_EQ(std::ranges::find(usage, "expansions", &MemoryUsage::structure)->elements, 4) << "empty expansions should count against the bound";
+	}
+
+	std::size_t total(const std::vector<MemoryUsage>& usage, std::size_t MemoryUsage::* field) {
+		std::size_t sum = 0;
+		for (const auto& structure : usage) {
+			sum += structure.*field;
+		}
+
+		return sum;
+	}
+
+	const MemoryUsage& structure(const std::vector<MemoryUsage>& usage, std::string_view name) {
+		return *std::ranges::find(usage, name, &MemoryUsage::structure);
+	}
+
+	TEST(MemoryRepository, MemoryUsage) {
+		auto repo = MemoryRepository();
+
+		for (const auto* uuid : { "000", "001", "002" }) {
+			repo.add_role(Role("role", uuid));
+		}
+		repo.include_roles({ { "000", "001" }, { "000", "002" } });
+
+		const auto usage = repo.memory_usage();
+		ASSERT_EQ(structure(usage, "roles").elements, 3);
+		ASSERT_EQ(structure(usage, "sub_roles").elements, 2);
+		ASSERT_EQ(structure(usage, "deps").elements, 2);
+		ASSERT_EQ(structure(usage, "name_index").elements, 3);
+
+		for (const auto& structure : usage) {
+			ASSERT_LE(structure.slack_bytes, structure.bytes) << structure.structure;
+		}
+	}
+
+	TEST(MemoryRepository, Compact) {
+		auto repo = MemoryRepository();
+
+		std::vector<Role> roles;
+		for (int i = 0; i < 2000; ++i) {
+			roles.emplace_back("role", std::to_string(i));
+		}
+		repo.add_roles(std::move(roles));
+
+		std::vector<std::pair<Role::Uuid, Role::Uuid>> edges;
+		for (int i = 1; i < 2000; ++i) {
+			edges.emplace_back("0", std::to_string(i));
+		}
+		repo.include_roles(edges);
+
+		for (int i = 2; i < 2000; ++i) {
+			repo.exclude_role("0", std::to_string(i));
+		}
+
+		ASSERT_EQ(repo.churn().live, 2001);
+		ASSERT_EQ(repo.churn().removed, 1998);
+
+		const auto snapshot = repo.snapshot();
+		const auto before = repo.memory_usage();
+
+		repo.compact();
+
+		const auto after = repo.memory_usage();
+		ASSERT_EQ(repo.churn().removed, 0);
+		ASSERT_LT(total(after, &MemoryUsage::slack_bytes), total(before, &MemoryUsage::slack_bytes));
+		ASSERT_LT(structure(after, "sub_roles").bytes, structure(before, "sub_roles").bytes);
+		ASSERT_EQ(structure(after, "roles").elements, 2000);
+
+		ASSERT_EQ(repo.dependencies("1").value().value(), (std::unordered_set<Role::Uuid>{ "0" }));
+		ASSERT_EQ(repo.find_by_name("role", 3000).size(), 2000);
+		ASSERT_EQ(repo.add_role(Role("role", "0")), RepositoryErr::ROLE_ALREADY_EXISTS);
+
+		// readers holding the old shards are not affected
+		std::size_t count = 0;
+		for (auto roles = snapshot->next(512); !roles.empty(); roles = snapshot->next(512)) {
+			count += roles.size();
+		}
+		ASSERT_EQ(count, 2000);
+	}
+
+	TEST(MemoryRepository, ConcurrentMutations) {
+		auto repo = MemoryRepository();
+
+		for (int i = 0; i < 16; ++i) {
+			repo.add_role(Role("role", std::to_string(i)));
+		}
+
+		{
+			std::vector<std::jthread> threads;
+			for (unsigned t = 0; t < 8; ++t) {
+				threads.emplace_back([&repo, t] {
+					std::mt19937 rng(t);
+					std::uniform_int_distribution<int> role(0, 15);
+
+					for (int i = 0; i < 2000; ++i) {
+						const auto parent = std::to_string(role(rng));
+						const auto child = std::to_string(role(rng));
+						if (i % 3 == 0) {
+							repo.exclude_role(parent, child);
+						}
+						else {
+							repo.include_role(parent, child);
+						}
+					}
+				});
+			}
+		}
+
+		// the reverse index has to mirror the included roles
+		const auto roles = repo.roles();
+		for (const auto& [uuid, role] : roles) {
+			std::unordered_set<Role::Uuid> parents;
+			for (const auto& [other_uuid, other] : roles) {
+				if (other.has_subrole(uuid)) {
+					parents.insert(other_uuid);
+				}
+			}
+
+			const auto deps = repo.dependencies(uuid).value();
+			ASSERT_EQ(deps.value_or(std::unordered_set<Role::Uuid>{}), parents) << uuid;
+		}
+	}
 }
\ No newline at end of file
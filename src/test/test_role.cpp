@@ -0,0 +1,68 @@
+#include "pch.h"
+
+// role.cpp is compiled in through test_memory_repository.cpp
+#include "..\common\role.h"
+
+namespace tser_test {
+	using namespace tser;
+
+	/// returns the error raised by the given parse function, or an empty string on success
+	std::string parse_error(std::string_view text, auto&& parse) {
+		try {
+			parse(text);
+		}
+		catch (const nlohmann::json::exception& e) {
+			return e.what();
+		}
+
+		return {};
+	}
+
+	Role parse_dom(std::string_view text) {
+		return nlohmann::json::parse(text).get<Role>();
+	}
+
+	TEST(Role, ParseMatchesDom) {
+		const std::string_view texts[] = {
+			R"({"name": "role_0", "id": "000"})",
+			R"({"id": "000", "name": "role_0", "includedRoles": ["001", "002"]})",
+			R"({"name": "role_0", "id": "000", "extra": {"name": 1, "id": [2]}, "includedRoles": []})",
+			R"({"name": "first", "id": "000", "name": "last"})",
+			R"({"name": "role_0", "id": "000", "includedRoles": [1], "includedRoles": ["001"]})",
+		};
+
+		for (const auto text : texts) {
+			ASSERT_EQ(Role::parse(text), parse_dom(text)) << text;
+		}
+	}
+
+	TEST(Role, ParseErrorsMatchDom) {
+		const std::string_view texts[] = {
+			R"()",
+			R"({"name": "role_0", "id": "000")",
+			R"(["name", "id"])",
+			R"("role")",
+			R"({"id": "000"})",
+			R"({"name": "role_0"})",
+			R"({"name": 1, "id": "000"})",
+			R"({"name": "role_0", "id": null})",
+			R"({"name": "role_0", "id": {"id": "000"}})",
+			R"({"name": "role_0", "id": "000", "includedRoles": "001"})",
+			R"({"name": "role_0", "id": "000", "includedRoles": ["001", 2, true]})",
+			R"({"name": "role_0", "id": "000", "includedRoles": [["001"]]})",
+		};
+
+		for (const auto text : texts) {
+			const auto expected = parse_error(text, parse_dom);
+			const auto actual = parse_error(text, &Role::parse);
+
+			ASSERT_FALSE(expected.empty()) << text;
+			ASSERT_EQ(actual, expected) << text;
+		}
+	}
+
+	TEST(Role, ParseErrorKeepsType) {
+		ASSERT_THROW(Role::parse(R"({"name": "role_0", "id": "000")"), nlohmann::json::parse_error);
+		ASSERT_THROW(Role::parse(R"({"name": 1, "id": "000"})"), nlohmann::json::type_error);
+	}
+}